@@ -23,13 +23,29 @@ multiple folders to have spare keys. 254 files, automated dual-channel symmetry:
 |                          Alice decrypts!               Bob decrypts!         |
 \______________________________________________________________________________/
 
- * keys incoming outgoing  (3 folders, all inside keys.)  *1GB RAM to get keys.*
+ * keys incoming outgoing  (3 folders, all inside keys.)  *32MB RAM to get keys*
      * 000 - 124           (125 keys in incoming folder, 2,000,014 char, 250MB.)
      * 000 - 124           (125 keys in outgoing folder, 2,000,014 char, 250MB.)
+   * incoming.pack         (Or, option 3 picks: 125 incoming keys in one file.)
+   * outgoing.pack         (Or, option 3 picks: 125 outgoing keys in one file.)
  * remaining.encrypt.txt   (Stores remaining encrypt, printed after encryption.)
  * remaining.decrypt.txt   (Stores remaining decrypt, printed after decryption.)
  * symmetry.entanglement   (Key generator removes this file on their end after.)
  * swapped                 (Option  4. Channels are to be swapped on both ends.)
+ * keys.state              (Next keys and counters. Remove after manual edits.)
+ * keys.reserve            (Keys taken by running processes. Remove with above.)
+ * keys.lock               (Held while keys.state changes. Stays, always empty.)
+ * keys.digest             (Option  9 keeps key hashes here for a quick rerun.)
+ * size.class              (Option  3 sets the largest file, and files per key.)
+ * keygen.checkpoint       (Option  3 until done. Resumes a stopped key run.)
+ * keygen.health           (Option  3 tells which key failed which health test.)
+ * io.settings             (Optional: I/O backend, queue depth, shred passes.)
+ * batch.plainfiles        (Option  5 encrypts every file here, in name order.)
+ * batch.cipherfiles       (Option  6 decrypts every file here, in name order.)
+ * plainfile of any size   (Option  7 encrypts it to frames of one cipherfile.)
+ * schemeOTP.socket        (While schemeOTP --daemon runs. See Daemon mode.)
+ * channels.registry       (Peers of --peer=ID, their keys in peers/ID folders.)
+ * FILE of --export=FILE   (All keys and the other side's state, for --import.)
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 If your operation prefers one-way file sharing as you work on the field and your
 outgoing keys are coming to an end, you and the other party can swap and restore
@@ -59,15 +75,4080 @@ and its directory will be  appended to your pending entry. Click on the terminal
 and press enter.   a.out now resides in the user directory, you may rename it to
 anything.  To run that executable, simply drag and drop it into a terminal, then
 click on the terminal and press enter.  Reminder:  executable's effect-directory
-is the user directory on your machine, for example:  /home/nikolay    Enjoy. */
+is the user directory on your machine, for example:  /home/nikolay    Enjoy.
+Keygen v3 uses every core: type  g++ -O2 -pthread  then space for a fast build. */
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>     //For isalnum() (peer IDs.)
+#include <cerrno>
+#include <chrono>
+#include <cmath>      //For sqrt() (keygen health tests.)
+#include <condition_variable> //For the keeper thread (daemon mode.)
+#include <cstddef>    //For offsetof() (key state checksum.)
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>   //For opendir() (batch mode.)
+#include <fcntl.h>    //For open() (block I/O.)
 #include <fstream>
 #include <iostream>
+#include <mutex>      //For call_once() (cipher kernel pick.)
+#include <signal.h>   //For sigprocmask() (daemon mode.)
+#include <sys/epoll.h>     //For epoll_wait() (daemon mode.)
+#include <sys/file.h> //For flock() (key reservation.)
+#include <sys/mman.h> //For mmap() (key packs.)
+#include <sys/resource.h>  //For getrusage() (stats.)
+#include <sys/signalfd.h>  //For signalfd() (daemon mode.)
+#include <sys/socket.h>    //For socket() (daemon mode.)
 #include <sys/stat.h> //For mkdir() (creating folders.)
+#include <sys/un.h>   //For sockaddr_un (daemon mode.)
+#include <thread>
+#include <unistd.h>   //For read(), write(), close() (block I/O.)
+#include <vector>
+#ifdef SCHEMEOTP_LIBRARY
+#include "schemeOTP.h" //The calls of Library, for programs linking this in.
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> //SSE2, AVX2 and AVX-512BW intrinsics (cipher kernels.)
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> //For io_uring (async I/O.) Without it, async I/O runs on threads.
+#include <sys/syscall.h>
+#define SCHEMEOTP_IO_URING
+#endif
+#endif
 using namespace std;
 
-int main()
+/*##############################################################################
+Block I/O. Keys, plainfiles and cipherfiles move in a few large read() / write()
+calls straight between the file and an unsigned char array. No per-character
+stream calls, and no (-128 - 127) conversions: the bytes on disk are the same.
+##############################################################################*/
+const long long block_io_size = 1048576; //Largest single read() / write(). The kernel may return less, loops below go on.
+
+//Gets file size in bytes, or -1 if the file can't be opened.
+long long block_file_size(const char file_name[])
+{	struct stat file_status;
+	if(stat(file_name, &file_status) != 0) {return -1;}
+	return file_status.st_size;
+}
+
+//Reads up to length bytes from the start of file_name into buffer[]. Returns bytes read, or -1 if the file can't be opened.
+long long block_read_file(const char file_name[], unsigned char buffer[], long long length)
+{	int file_descriptor = open(file_name, O_RDONLY);
+	if(file_descriptor < 0) {return -1;}
+	long long done = 0;
+	while(done < length)
+	{	long long request = (length - done);
+		if(request > block_io_size) {request = block_io_size;}
+		ssize_t got = read(file_descriptor, buffer + done, request);
+		if(got < 0) {if(errno == EINTR) {continue;} break;}
+		if(got == 0) {break;} //End of file.
+		done += got;
+	}
+	close(file_descriptor);
+	return done;
+}
+
+//Reads up to length bytes from offset in file_name into buffer[]. Returns bytes read, or -1 if the file can't be opened.
+long long block_read_range(const char file_name[], long long offset, unsigned char buffer[], long long length)
+{	int file_descriptor = open(file_name, O_RDONLY);
+	if(file_descriptor < 0) {return -1;}
+	long long done = 0;
+	while(done < length)
+	{	long long request = (length - done);
+		if(request > block_io_size) {request = block_io_size;}
+		ssize_t got = pread(file_descriptor, buffer + done, request, offset + done);
+		if(got < 0) {if(errno == EINTR) {continue;} break;}
+		if(got == 0) {break;} //End of file.
+		done += got;
+	}
+	close(file_descriptor);
+	return done;
+}
+
+//Writes length bytes of buffer[] at offset in file_name, which must exist (other threads write elsewhere in it.) Returns false if anything fails.
+bool block_write_range(const char file_name[], long long offset, const unsigned char buffer[], long long length)
+{	int file_descriptor = open(file_name, O_WRONLY);
+	if(file_descriptor < 0) {return false;}
+	long long done = 0;
+	while(done < length)
+	{	long long request = (length - done);
+		if(request > block_io_size) {request = block_io_size;}
+		ssize_t put = pwrite(file_descriptor, buffer + done, request, offset + done);
+		if(put < 0) {if(errno == EINTR) {continue;} break;}
+		done += put;
+	}
+	if(close(file_descriptor) != 0) {return false;}
+	return (done == length);
+}
+
+//Creates or truncates file_name and writes length bytes of buffer[] to it. Returns false if anything fails.
+bool block_write_file(const char file_name[], const unsigned char buffer[], long long length)
+{	int file_descriptor = open(file_name, (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+	if(file_descriptor < 0) {return false;}
+	long long done = 0;
+	while(done < length)
+	{	long long request = (length - done);
+		if(request > block_io_size) {request = block_io_size;}
+		ssize_t put = write(file_descriptor, buffer + done, request);
+		if(put < 0) {if(errno == EINTR) {continue;} break;}
+		done += put;
+	}
+	if(close(file_descriptor) != 0) {return false;}
+	return (done == length);
+}
+
+/*##############################################################################
+Async I/O. Reads and writes that don't depend on each other are submitted as a
+group and run together: a pass of shredding puts all its writes in flight, and
+encrypt reads the key and the plainfile at once. On Linux they go to io_uring,
+one ring per thread kept for the thread's life; where it's missing or refused
+they go to a small pool of threads. Either way at most queue_depth are in
+flight, and a ring that fails midway is waited out before anything is redone.
+Settings are in optional text file io.settings: "backend io_uring" or "backend
+threads", "queue_depth 8", "shred_passes 2" (one per line, all optional.) Shred
+passes alternate zeros and ones, 2 to 16 of them and always an even count (3
+becomes 4): a used piece must end up all ones.
+##############################################################################*/
+const int io_backend_threads  =  0;
+const int io_backend_uring    =  1;
+const int io_shred_passes_max = 16;
+
+struct io_settings
+{	int backend;
+	int queue_depth;  //Reads or writes in flight at once.
+	int shred_passes; //Overwrites of a used key: zeros, ones, zeros...
+};
+
+io_settings io_config = {io_backend_uring, 8, 2};
+atomic<bool> io_uring_refused(false); //Set once io_uring fails to start here: the threads take over.
+
+void io_settings_read()
+{	ifstream in_stream("io.settings");
+	string name, value;
+	while(in_stream >> name >> value)
+	{	if(name == "backend"     ) {io_config.backend = ((value == "threads") ? io_backend_threads : io_backend_uring);}
+		if(name == "queue_depth" ) {io_config.queue_depth  = max(1, min(256, atoi(value.c_str())));}
+		if(name == "shred_passes") {io_config.shred_passes = max(2, min(io_shred_passes_max, atoi(value.c_str())));}
+		io_config.shred_passes += (io_config.shred_passes % 2); //Ends on a ones pass.
+	}
+}
+
+const io_settings& io_settings_get()
+{	static once_flag read;
+	call_once(read, io_settings_read);
+	return io_config;
+}
+
+//Names the backend in use, for timing reports.
+string io_backend_name()
+{	const io_settings& settings = io_settings_get();
+	string name = "threads";
+	if((settings.backend == io_backend_uring) && (io_uring_refused == false)) {name = "io_uring";}
+	return name + ", queue depth " + to_string(settings.queue_depth);
+}
+
+const int io_read  = 0;
+const int io_write = 1;
+
+struct io_request
+{	int            operation; //io_read or io_write.
+	int            file_descriptor;
+	unsigned char* buffer;
+	long long      length;
+	long long      offset;
+	long long      result;    //Bytes moved so far, or -1.
+};
+
+//Moves what's left of one request with plain pread() / pwrite() calls.
+void io_finish(io_request& request)
+{	long long done = max(0LL, request.result);
+	while(done < request.length)
+	{	long long piece = min(request.length - done, block_io_size);
+		ssize_t moved;
+		if(request.operation == io_read) {moved = pread (request.file_descriptor, request.buffer + done, piece, request.offset + done);}
+		else                             {moved = pwrite(request.file_descriptor, request.buffer + done, piece, request.offset + done);}
+		if(moved < 0) {if(errno == EINTR) {continue;} break;}
+		if(moved == 0) {break;} //End of file.
+		done += moved;
+	}
+	request.result = done;
+}
+
+void io_worker(io_request requests[], int count, atomic<int>* next_request)
+{	for(int a = next_request->fetch_add(1); a < count; a = next_request->fetch_add(1)) {io_finish(requests[a]);}
+}
+
+#ifdef SCHEMEOTP_IO_URING
+//One io_uring instance: the submission and completion rings shared with the kernel (raw system calls, no liburing.)
+struct io_ring
+{	int            file_descriptor;
+	unsigned char* submit_map;
+	size_t         submit_map_size;
+	unsigned char* complete_map;
+	size_t         complete_map_size;
+	io_uring_sqe*  entries;
+	size_t         entries_size;
+	unsigned*      submit_head;
+	unsigned*      submit_tail;
+	unsigned*      submit_mask;
+	unsigned*      submit_array;
+	unsigned*      complete_head;
+	unsigned*      complete_tail;
+	unsigned*      complete_mask;
+	io_uring_cqe*  completions;
+};
+
+void io_ring_close(io_ring& ring)
+{	if(ring.entries      != MAP_FAILED) {munmap(ring.entries     , ring.entries_size     );}
+	if(ring.complete_map != MAP_FAILED) {munmap(ring.complete_map, ring.complete_map_size);}
+	if(ring.submit_map   != MAP_FAILED) {munmap(ring.submit_map  , ring.submit_map_size  );}
+	close(ring.file_descriptor);
+}
+
+bool io_ring_open(io_ring& ring, unsigned depth)
+{	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring.file_descriptor = syscall(__NR_io_uring_setup, depth, &params);
+	if(ring.file_descriptor < 0) {return false;}
+	
+	ring.submit_map_size   = (params.sq_off.array + (params.sq_entries * sizeof(unsigned)));
+	ring.complete_map_size = (params.cq_off.cqes  + (params.cq_entries * sizeof(io_uring_cqe)));
+	ring.entries_size      = (params.sq_entries * sizeof(io_uring_sqe));
+	ring.submit_map   = (unsigned char*)mmap(0, ring.submit_map_size  , (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), ring.file_descriptor, IORING_OFF_SQ_RING);
+	ring.complete_map = (unsigned char*)mmap(0, ring.complete_map_size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), ring.file_descriptor, IORING_OFF_CQ_RING);
+	ring.entries      = (io_uring_sqe* )mmap(0, ring.entries_size     , (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), ring.file_descriptor, IORING_OFF_SQES   );
+	if((ring.submit_map == MAP_FAILED) || (ring.complete_map == MAP_FAILED) || (ring.entries == MAP_FAILED)) {io_ring_close(ring); return false;}
+	
+	ring.submit_head   = (unsigned*)(ring.submit_map + params.sq_off.head);
+	ring.submit_tail   = (unsigned*)(ring.submit_map + params.sq_off.tail);
+	ring.submit_mask   = (unsigned*)(ring.submit_map + params.sq_off.ring_mask);
+	ring.submit_array  = (unsigned*)(ring.submit_map + params.sq_off.array);
+	ring.complete_head = (unsigned*)(ring.complete_map + params.cq_off.head);
+	ring.complete_tail = (unsigned*)(ring.complete_map + params.cq_off.tail);
+	ring.complete_mask = (unsigned*)(ring.complete_map + params.cq_off.ring_mask);
+	ring.completions   = (io_uring_cqe*)(ring.complete_map + params.cq_off.cqes);
+	return true;
+}
+
+//Each thread keeps one ring from its first request on, closed when the thread ends (or after io_uring_enter() fails.)
+struct io_thread_ring
+{	io_ring ring;
+	bool    open;
+	~io_thread_ring() {if(open == true) {io_ring_close(ring);}}
+};
+thread_local io_thread_ring io_ring_here = {io_ring(), false};
+
+//Waits for every request the kernel has taken to complete, so that no write is still reading a buffer the caller reuses.
+//Requests put in the ring but never taken are taken out again. in_flight drops to 0.
+void io_uring_drain(io_ring& ring, io_request requests[], int& in_flight)
+{	unsigned taken = __atomic_load_n(ring.submit_head, __ATOMIC_ACQUIRE);
+	in_flight -= (*ring.submit_tail - taken);
+	__atomic_store_n(ring.submit_tail, taken, __ATOMIC_RELEASE);
+	while(in_flight > 0)
+	{	unsigned head = *ring.complete_head;
+		for(; head != __atomic_load_n(ring.complete_tail, __ATOMIC_ACQUIRE); head++, in_flight--)
+		{	io_uring_cqe* completion = &ring.completions[head & *ring.complete_mask];
+			requests[completion->user_data].result = ((completion->res < 0) ? 0 : completion->res);
+		}
+		__atomic_store_n(ring.complete_head, head, __ATOMIC_RELEASE);
+		if(in_flight == 0) {break;}
+		if(syscall(__NR_io_uring_enter, ring.file_descriptor, 0, in_flight, IORING_ENTER_GETEVENTS, 0, 0) < 0) {usleep(1000);} //Completions still land.
+	}
+}
+
+//Runs the requests through this thread's ring, at most depth in flight. Returns false if io_uring can't be used here (nothing
+//was run.) If io_uring_enter() fails, waits out what is in flight and leaves the rest (result 0) to the caller's fallback.
+bool io_uring_run(io_request requests[], int count, int depth)
+{	if(io_ring_here.open == false)
+	{	if(io_ring_open(io_ring_here.ring, depth) == false) {io_uring_refused = true; return false;}
+		io_ring_here.open = true;
+	}
+	io_ring& ring = io_ring_here.ring;
+	
+	int next = 0, in_flight = 0, done = 0;
+	while(done < count)
+	{	unsigned tail = *ring.submit_tail;
+		for(; (next < count) && (in_flight < depth); next++, in_flight++)
+		{	unsigned index = (tail++ & *ring.submit_mask);
+			io_uring_sqe* entry = &ring.entries[index];
+			memset(entry, 0, sizeof(*entry));
+			entry->opcode    = ((requests[next].operation == io_read) ? IORING_OP_READ : IORING_OP_WRITE);
+			entry->fd        = requests[next].file_descriptor;
+			entry->addr      = (unsigned long long)requests[next].buffer;
+			entry->len       = requests[next].length;
+			entry->off       = requests[next].offset;
+			entry->user_data = next;
+			ring.submit_array[index] = index;
+		}
+		__atomic_store_n(ring.submit_tail, tail, __ATOMIC_RELEASE);
+		
+		unsigned to_submit = (tail - __atomic_load_n(ring.submit_head, __ATOMIC_ACQUIRE));
+		if(syscall(__NR_io_uring_enter, ring.file_descriptor, to_submit, 1, IORING_ENTER_GETEVENTS, 0, 0) < 0)
+		{	if(errno == EINTR) {continue;}
+			io_uring_drain(ring, requests, in_flight); //What's not done finishes in io_submit_all(), without the ring.
+			io_ring_close(ring);
+			io_ring_here.open = false;
+			return true;
+		}
+		
+		unsigned head = *ring.complete_head;
+		for(; head != __atomic_load_n(ring.complete_tail, __ATOMIC_ACQUIRE); head++, in_flight--, done++)
+		{	io_uring_cqe* completion = &ring.completions[head & *ring.complete_mask];
+			requests[completion->user_data].result = ((completion->res < 0) ? 0 : completion->res);
+		}
+		__atomic_store_n(ring.complete_head, head, __ATOMIC_RELEASE);
+	}
+	return true;
+}
+#endif
+
+//Runs every request, together, and returns once all are done. Returns false if any failed or came up short.
+bool io_submit_all(io_request requests[], int count)
+{	const io_settings& settings = io_settings_get();
+	for(int a = 0; a < count; a++) {requests[a].result = 0;}
+	
+	bool ran = false;
+	#ifdef SCHEMEOTP_IO_URING
+	if((settings.backend == io_backend_uring) && (io_uring_refused == false)) {ran = io_uring_run(requests, count, settings.queue_depth);}
+	#endif
+	if(ran == false)
+	{	atomic<int> next_request(0);
+		vector<thread> workers;
+		for(int a = 1; a < min(count, settings.queue_depth); a++) {workers.push_back(thread(io_worker, requests, count, &next_request));}
+		io_worker(requests, count, &next_request);
+		for(unsigned int a = 0; a < workers.size(); a++) {workers[a].join();}
+	}
+	
+	bool complete = true;
+	for(int a = 0; a < count; a++)
+	{	if(requests[a].result < requests[a].length) {io_finish(requests[a]);} //Short, or refused by the ring (old kernel.)
+		if(requests[a].result < requests[a].length) {complete = false;}
+	}
+	return complete;
+}
+
+/*##############################################################################
+Memory wiping. Writing zeros to an array that is never read again is a "dead
+store" the optimizer may delete, taking v2.2's 255-then-0 loops with it. These
+wipes end with an empty asm statement that claims to read the memory, so every
+store must happen. Large wipes use non-temporal stores, which go to RAM without
+first pulling each line into the cache, and can be split across threads.
+##############################################################################*/
+const long long secure_wipe_stream_size = 1048576; //Wipes at least this large use non-temporal stores.
+const long long secure_wipe_thread_size = 67108864; //Wipes at least this large are split across threads.
+
+void secure_wipe(void* memory, long long length)
+{	unsigned char* bytes = (unsigned char*)memory;
+	long long a = 0;
+	#if defined(__x86_64__)
+	if(length >= secure_wipe_stream_size)
+	{	for(; (a < length) && ((((unsigned long long)(bytes + a)) % 16) != 0); a++) {bytes[a] = 0;} //Up to an aligned address.
+		__m128i zeros = _mm_setzero_si128();
+		for(; (a + 64) <= length; a += 64)
+		{	_mm_stream_si128((__m128i*)(bytes + a     ), zeros);
+			_mm_stream_si128((__m128i*)(bytes + a + 16), zeros);
+			_mm_stream_si128((__m128i*)(bytes + a + 32), zeros);
+			_mm_stream_si128((__m128i*)(bytes + a + 48), zeros);
+		}
+		_mm_sfence(); //Non-temporal stores are done before anything after this.
+	}
+	#endif
+	memset(bytes + a, 0, length - a);
+	__asm__ __volatile__("" : : "r"(memory) : "memory"); //Compiler barrier: the zeros above count as used.
+}
+
+//Same as secure_wipe(), split into one slice per thread when large.
+void secure_wipe_parallel(void* memory, long long length, int thread_count)
+{	if((length < secure_wipe_thread_size) || (thread_count < 2)) {secure_wipe(memory, length); return;}
+	unsigned char* bytes = (unsigned char*)memory;
+	vector<thread> threads;
+	for(int t = 1; t < thread_count; t++)
+	{	long long first = ((length *  t     ) / thread_count);
+		long long last  = ((length * (t + 1)) / thread_count);
+		threads.push_back(thread(secure_wipe, bytes + first, last - first));
+	}
+	secure_wipe(bytes, length / thread_count);
+	for(unsigned int t = 0; t < threads.size(); t++) {threads[t].join();}
+}
+
+/*##############################################################################
+Shredder. A used key is overwritten with all zeros, then all ones (as in v2.1 on)
+from an aligned buffer, and fdatasync() after each pass makes sure each pass
+reaches the disk instead of only the page cache before the file is removed. It
+runs on its own thread so cipherfile/plainfile is ready while the key is being
+shredded; the caller joins it at the end and prints how long each pass took.
+The writes of one pass go out together (see Async I/O), as does the pass count.
+##############################################################################*/
+const long long shred_buffer_size = 262144; //One write. A pass of a 2,000,014-char key puts 8 in flight at once.
+const int shred_kind_file  = 0; //A key file, overwritten then removed.
+const int shred_kind_slot  = 1; //A key pack slot, overwritten in place and marked used.
+const int shred_kind_piece = 2; //One used piece of a key (size classes), overwritten in place. The rest of the key stays.
+
+struct shred_report
+{	double pass_seconds[2]; //[0] the zeros passes, [1] the ones passes (one each by default.)
+	int    passes;
+	int    kind;
+	bool   failed;
+};
+
+//Overwrites length bytes from offset with 00000000, then 11111111 (and so on: shred_passes) with a sync after each pass. Returns false if anything fails.
+bool shred_range(int file_descriptor, long long offset, long long length, shred_report* report)
+{	report->pass_seconds[0] = 0;
+	report->pass_seconds[1] = 0;
+	report->passes = io_settings_get().shred_passes;
+	void* buffer = 0;
+	if(posix_memalign(&buffer, 4096, shred_buffer_size) != 0) {return false;}
+	
+	//Every write of a pass reads the same buffer, so they can all be in flight at once.
+	vector<io_request> writes((length + shred_buffer_size - 1) / shred_buffer_size);
+	for(unsigned int a = 0; a < writes.size(); a++)
+	{	writes[a].operation       = io_write;
+		writes[a].file_descriptor = file_descriptor;
+		writes[a].buffer          = (unsigned char*)buffer;
+		writes[a].offset          = (offset + (a * shred_buffer_size));
+		writes[a].length          = min(shred_buffer_size, length - (a * shred_buffer_size));
+	}
+	
+	bool pass_failed = false;
+	for(int pass = 0; pass < report->passes; pass++)
+	{	chrono::steady_clock::time_point pass_start = chrono::steady_clock::now();
+		if((pass % 2) == 0) {memset(buffer, 0x00, shred_buffer_size);} //Binary: 00000000
+		else                {memset(buffer, 0xFF, shred_buffer_size);} //Binary: 11111111
+		
+		if(io_submit_all(writes.data(), writes.size()) == false) {pass_failed = true;}
+		if(fdatasync(file_descriptor) != 0) {pass_failed = true;}
+		report->pass_seconds[pass % 2] += chrono::duration<double>(chrono::steady_clock::now() - pass_start).count();
+	}
+	free(buffer);
+	return (pass_failed == false);
+}
+
+//Overwrites file_name (00000000, then 11111111...) with a sync after each pass, then removes it.
+void shred_file(string file_name, shred_report* report)
+{	report->kind   = shred_kind_file;
+	report->failed = true;
+	int file_descriptor = open(file_name.c_str(), O_WRONLY);
+	if(file_descriptor < 0) {return;}
+	struct stat file_status;
+	if(fstat(file_descriptor, &file_status) != 0) {close(file_descriptor); return;}
+	
+	bool shredded = shred_range(file_descriptor, 0, file_status.st_size, report);
+	close(file_descriptor);
+	if(remove(file_name.c_str()) != 0) {shredded = false;}
+	report->failed = (shredded == false);
+}
+
+//Takes file_name out of the 000 - 124 numbering right away (so no later run can pick it up), then shreds it on a new thread.
+thread shred_file_async(const char file_name[], shred_report* report)
+{	string shred_name = string(file_name) + ".shred"; //If a run dies mid-shred, this file is left over and can be removed by hand.
+	if(rename(file_name, shred_name.c_str()) != 0) {shred_name = file_name;}
+	char folder[4096]; //Named from the root: the library may be in another store's folder by the time the thread opens it.
+	if((shred_name[0] != '/') && (getcwd(folder, sizeof(folder)) != 0)) {shred_name = (string(folder) + "/" + shred_name);}
+	return thread(shred_file, shred_name, report);
+}
+
+//Says what was shredded and how: a key file is removed, a pack slot or a piece is wiped where it is.
+void shred_print_report(const shred_report& report)
+{	const char* what = "Key";
+	if(report.kind == shred_kind_piece) {what = "Used key piece";}
+	if(report.failed == true)
+	{	if(report.kind == shred_kind_piece) {cout << "Wiping the used key piece FAILED, remove the whole key by hand!\n";}
+		else                                {cout << "Key shredding FAILED, remove the used key by hand!\n";}
+		return;
+	}
+	if(report.passes == 2) {cout << what << " shredded: pass 1 (zeros) " << ((int)(report.pass_seconds[0] * 10000) / 10.0) << "ms, pass 2 (ones) ";}
+	else                   {cout << what << " shredded in " << report.passes << " passes: zeros " << ((int)(report.pass_seconds[0] * 10000) / 10.0) << "ms, ones ";}
+	cout << ((int)(report.pass_seconds[1] * 10000) / 10.0) << "ms, synced";
+	if     (report.kind == shred_kind_file) {cout << " and removed.\n";}
+	else if(report.kind == shred_kind_slot) {cout << " in place, pack slot marked used.\n";}
+	else                                    {cout << " in place, the key's other pieces kept.\n";}
+}
+
+/*##############################################################################
+Stats (schemeOTP --stats, or --stats=log file.) Each option times its phases on
+the monotonic clock and counts their bytes: the key reserved, key and file read,
+the cipher, the file written, each shred pass, the counters rewritten and so on.
+At exit one JSON record goes to stderr (or is appended to the log file) with the
+phases, total time and peak resident memory. Phases of the same name add up, so
+batch mode, large files and the daemon report totals and counts. When off, each
+phase costs one test of a bool. Goes with --daemon as well as with the menu.
+##############################################################################*/
+const int stats_phase_max = 24;
+
+struct stats_phase
+{	const char* name;
+	double      seconds;
+	long long   bytes;
+	long long   count;
+};
+
+struct stats_run
+{	bool                             on;
+	int                              log_descriptor; //2 = stderr.
+	string                           mode;           //"1" - "9" (the option), or "daemon".
+	chrono::steady_clock::time_point start;
+	stats_phase                      phases[stats_phase_max];
+	int                              phase_count;
+	mutex                            lock;           //Shredder, keeper and worker threads add phases too.
+};
+
+stats_run stats;
+
+//Gets the time a phase starts, or nothing when stats are off.
+chrono::steady_clock::time_point stats_begin()
+{	if(stats.on == false) {return chrono::steady_clock::time_point();}
+	return chrono::steady_clock::now();
+}
+
+void stats_add(const char name[], double seconds, long long bytes)
+{	if(stats.on == false) {return;}
+	lock_guard<mutex> hold(stats.lock);
+	int a = 0;
+	while((a < stats.phase_count) && (strcmp(stats.phases[a].name, name) != 0)) {a++;}
+	if(a == stats_phase_max) {return;}
+	if(a == stats.phase_count) {stats.phases[a].name = name; stats.phases[a].seconds = 0; stats.phases[a].bytes = 0; stats.phases[a].count = 0; stats.phase_count++;}
+	stats.phases[a].seconds += seconds;
+	stats.phases[a].bytes   += bytes;
+	stats.phases[a].count++;
+}
+
+//Ends a phase begun with stats_begin(): adds the time since, and the bytes it moved.
+void stats_end(const char name[], chrono::steady_clock::time_point begin, long long bytes)
+{	if(stats.on == false) {return;}
+	stats_add(name, chrono::duration<double>(chrono::steady_clock::now() - begin).count(), bytes);
+}
+
+//Adds the passes of one shred, of length bytes each.
+void stats_shred(const shred_report& report, long long length)
+{	if(stats.on == false) {return;}
+	stats_add("shred_zeros", report.pass_seconds[0], length * ((report.passes + 1) / 2));
+	stats_add("shred_ones" , report.pass_seconds[1], length * ( report.passes      / 2));
+}
+
+//Writes the JSON record (registered with atexit(), so every return from main() gets one.)
+void stats_emit()
+{	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	lock_guard<mutex> hold(stats.lock);
+	string record = "{\"mode\": \"" + stats.mode + "\", \"seconds\": " + to_string(chrono::duration<double>(chrono::steady_clock::now() - stats.start).count())
+	              + ", \"peak_rss_kb\": " + to_string(usage.ru_maxrss) + ", \"phases\": [";
+	for(int a = 0; a < stats.phase_count; a++)
+	{	if(a > 0) {record += ", ";}
+		record += "{\"name\": \"" + string(stats.phases[a].name) + "\", \"seconds\": " + to_string(stats.phases[a].seconds)
+		        + ", \"bytes\": " + to_string(stats.phases[a].bytes) + ", \"count\": " + to_string(stats.phases[a].count) + "}";
+	}
+	record += "]}\n";
+	if(write(stats.log_descriptor, record.data(), record.size()) < 0) {} //Nowhere left to report a failure.
+}
+
+//Turns stats on. argument is what follows "--stats": "" (stderr) or "=log file". Returns false if the log can't be opened.
+bool stats_start(const char argument[])
+{	stats.log_descriptor = 2;
+	if(argument[0] == '=') {stats.log_descriptor = open(argument + 1, (O_WRONLY | O_CREAT | O_APPEND), 0666);} //Opened now: --bench changes folder.
+	if(stats.log_descriptor < 0) {return false;}
+	stats.on    = true;
+	stats.mode  = "menu";
+	stats.start = chrono::steady_clock::now();
+	atexit(stats_emit);
+	return true;
+}
+
+/*##############################################################################
+Cipher kernels. Encryption is plainfile + key (mod 256) and decryption is cipher
+- key (mod 256), byte by byte--exactly what unsigned char arithmetic does when
+it wraps. So each is one instruction per 16, 32 or 64 bytes on x86 (SSE2, AVX2,
+AVX-512BW.) The widest one this CPU has is picked once, at first use.
+##############################################################################*/
+void cipher_add_scalar(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	for(long long a = 0; a < length; a++) {out[a] = (x[a] + y[a]);}
+}
+
+void cipher_subtract_scalar(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	for(long long a = 0; a < length; a++) {out[a] = (x[a] - y[a]);}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2"))) void cipher_add_sse2(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 16) <= length; a += 16) {_mm_storeu_si128((__m128i*)(out + a), _mm_add_epi8(_mm_loadu_si128((const __m128i*)(x + a)), _mm_loadu_si128((const __m128i*)(y + a))));}
+	cipher_add_scalar(out + a, x + a, y + a, length - a);
+}
+
+__attribute__((target("sse2"))) void cipher_subtract_sse2(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 16) <= length; a += 16) {_mm_storeu_si128((__m128i*)(out + a), _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(x + a)), _mm_loadu_si128((const __m128i*)(y + a))));}
+	cipher_subtract_scalar(out + a, x + a, y + a, length - a);
+}
+
+__attribute__((target("avx2"))) void cipher_add_avx2(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 32) <= length; a += 32) {_mm256_storeu_si256((__m256i*)(out + a), _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(x + a)), _mm256_loadu_si256((const __m256i*)(y + a))));}
+	cipher_add_scalar(out + a, x + a, y + a, length - a);
+}
+
+__attribute__((target("avx2"))) void cipher_subtract_avx2(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 32) <= length; a += 32) {_mm256_storeu_si256((__m256i*)(out + a), _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*)(x + a)), _mm256_loadu_si256((const __m256i*)(y + a))));}
+	cipher_subtract_scalar(out + a, x + a, y + a, length - a);
+}
+
+__attribute__((target("avx512bw"))) void cipher_add_avx512bw(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 64) <= length; a += 64) {_mm512_storeu_si512((void*)(out + a), _mm512_add_epi8(_mm512_loadu_si512((const void*)(x + a)), _mm512_loadu_si512((const void*)(y + a))));}
+	cipher_add_scalar(out + a, x + a, y + a, length - a);
+}
+
+__attribute__((target("avx512bw"))) void cipher_subtract_avx512bw(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	long long a = 0;
+	for(; (a + 64) <= length; a += 64) {_mm512_storeu_si512((void*)(out + a), _mm512_sub_epi8(_mm512_loadu_si512((const void*)(x + a)), _mm512_loadu_si512((const void*)(y + a))));}
+	cipher_subtract_scalar(out + a, x + a, y + a, length - a);
+}
+#endif
+
+typedef void (*cipher_kernel)(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length);
+cipher_kernel cipher_add_kernel      = 0;
+cipher_kernel cipher_subtract_kernel = 0;
+const char*   cipher_kernel_name     = "scalar";
+
+void cipher_pick_kernels()
+{	cipher_add_kernel      = cipher_add_scalar;
+	cipher_subtract_kernel = cipher_subtract_scalar;
+	#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if     (__builtin_cpu_supports("avx512bw")) {cipher_add_kernel = cipher_add_avx512bw; cipher_subtract_kernel = cipher_subtract_avx512bw; cipher_kernel_name = "AVX-512BW";}
+	else if(__builtin_cpu_supports("avx2"    )) {cipher_add_kernel = cipher_add_avx2    ; cipher_subtract_kernel = cipher_subtract_avx2    ; cipher_kernel_name = "AVX2"     ;}
+	else if(__builtin_cpu_supports("sse2"    )) {cipher_add_kernel = cipher_add_sse2    ; cipher_subtract_kernel = cipher_subtract_sse2    ; cipher_kernel_name = "SSE2"     ;}
+	#endif
+}
+
+//out[a] = (x[a] + y[a]) % 256. out[] may be x[] or y[].
+void cipher_add_bytes(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	static once_flag picked;
+	call_once(picked, cipher_pick_kernels);
+	cipher_add_kernel(out, x, y, length);
+}
+
+//out[a] = (x[a] - y[a]) mod 256, same as the v2.2 decryption formula. out[] may be x[] or y[].
+void cipher_subtract_bytes(unsigned char out[], const unsigned char x[], const unsigned char y[], long long length)
+{	static once_flag picked;
+	call_once(picked, cipher_pick_kernels);
+	cipher_subtract_kernel(out, x, y, length);
+}
+
+/*##############################################################################
+Key packs. Instead of 250 key files, option 3 can write two pack files: keys/
+incoming.pack and keys/outgoing.pack, each a 4096-byte header and 125 key slots
+made in full up front. A pack is mapped into memory, so encryption reads a key
+where it lies in the page cache with no copy to an array first. A used slot is
+wiped in place (zeros, then ones, each synced as the shredder does) and marked
+used in the header. Two files to share, and no file creation or removal per key.
+Slots start on page boundaries so wiping one syncs only that slot's own pages.
+##############################################################################*/
+const int       key_pack_slots       =     125;
+const long long key_pack_header_size =    4096;
+const long long key_pack_slot_stride = 2002944; //2,000,014 rounded up to whole 4096-byte pages.
+
+struct key_pack_header
+{	char          magic[8];              //"OTPpack1"
+	int           slot_count;            //125
+	int           slot_size;             //2,000,014
+	long long     slot_stride;           //2,002,944
+	unsigned char used[key_pack_slots];  //1 once a slot is wiped.
+};
+
+struct key_pack
+{	int            file_descriptor;
+	unsigned char* map;
+	long long      map_length;
+};
+
+const char* key_pack_name(bool outgoing)
+{	if(outgoing == true) {return "./keys/outgoing.pack";}
+	else                 {return "./keys/incoming.pack";}
+}
+
+bool key_pack_exists(bool outgoing)
+{	struct stat file_status;
+	return (stat(key_pack_name(outgoing), &file_status) == 0);
+}
+
+bool key_pack_header_valid(const key_pack_header& header)
+{	return ((memcmp(header.magic, "OTPpack1", 8) == 0) && (header.slot_count == key_pack_slots) && (header.slot_size == 2000014) && (header.slot_stride == key_pack_slot_stride));
+}
+
+//Creates a pack with all its space allocated and every slot unused. (Option 3 then writes the keys into it.)
+bool key_pack_create(bool outgoing)
+{	int file_descriptor = open(key_pack_name(outgoing), (O_RDWR | O_CREAT | O_TRUNC), 0666);
+	if(file_descriptor < 0) {return false;}
+	bool created = (posix_fallocate(file_descriptor, 0, key_pack_header_size + (key_pack_slots * key_pack_slot_stride)) == 0);
+	
+	unsigned char header_page[key_pack_header_size] = {0};
+	key_pack_header* header = (key_pack_header*)header_page;
+	memcpy(header->magic, "OTPpack1", 8);
+	header->slot_count  = key_pack_slots;
+	header->slot_size   = 2000014;
+	header->slot_stride = key_pack_slot_stride;
+	if(pwrite(file_descriptor, header_page, key_pack_header_size, 0) != key_pack_header_size) {created = false;}
+	if(close(file_descriptor) != 0) {created = false;}
+	return created;
+}
+
+//Writes one key to slot number (option 3.)
+bool key_pack_write_slot(bool outgoing, int number, const unsigned char key[])
+{	int file_descriptor = open(key_pack_name(outgoing), O_WRONLY);
+	if(file_descriptor < 0) {return false;}
+	long long offset = (key_pack_header_size + (number * key_pack_slot_stride));
+	long long done = 0;
+	while(done < 2000014)
+	{	long long request = (2000014 - done);
+		if(request > block_io_size) {request = block_io_size;}
+		ssize_t put = pwrite(file_descriptor, key + done, request, offset + done);
+		if(put < 0) {if(errno == EINTR) {continue;} break;}
+		done += put;
+	}
+	if(close(file_descriptor) != 0) {return false;}
+	return (done == 2000014);
+}
+
+//Maps a whole pack, readable and writable (slots are wiped through the mapping.) Returns false if it's missing or not a pack.
+bool key_pack_open(key_pack& pack, bool outgoing)
+{	pack.map = 0;
+	pack.map_length = (key_pack_header_size + (key_pack_slots * key_pack_slot_stride));
+	pack.file_descriptor = open(key_pack_name(outgoing), O_RDWR);
+	if(pack.file_descriptor < 0) {return false;}
+	if(block_file_size(key_pack_name(outgoing)) != pack.map_length) {close(pack.file_descriptor); return false;}
+	
+	void* map = mmap(0, pack.map_length, (PROT_READ | PROT_WRITE), MAP_SHARED, pack.file_descriptor, 0);
+	if(map == MAP_FAILED) {close(pack.file_descriptor); return false;}
+	pack.map = (unsigned char*)map;
+	if(key_pack_header_valid(*(key_pack_header*)pack.map) == false) {munmap(pack.map, pack.map_length); close(pack.file_descriptor); pack.map = 0; return false;}
+	return true;
+}
+
+void key_pack_close(key_pack& pack)
+{	if(pack.map == 0) {return;}
+	munmap(pack.map, pack.map_length);
+	close(pack.file_descriptor);
+	pack.map = 0;
+}
+
+unsigned char* key_pack_slot(const key_pack& pack, int number)
+{	return (pack.map + key_pack_header_size + (number * key_pack_slot_stride));
+}
+
+bool key_pack_slot_used(const key_pack& pack, int number)
+{	return (((key_pack_header*)pack.map)->used[number] != 0);
+}
+
+//Gets the number of the first unused slot from first_number on, or -1 if none. Reads only the header.
+int key_pack_probe(bool outgoing, int first_number)
+{	int file_descriptor = open(key_pack_name(outgoing), O_RDONLY);
+	if(file_descriptor < 0) {return -1;}
+	key_pack_header header;
+	bool valid = (pread(file_descriptor, &header, sizeof(header), 0) == (ssize_t)sizeof(header));
+	close(file_descriptor);
+	if((valid == false) || (key_pack_header_valid(header) == false)) {return -1;}
+	
+	for(int number = first_number; number < key_pack_slots; number++)
+	{	if(header.used[number] == 0) {return number;}
+	}
+	return -1;
+}
+
+//Wipes slot number in place (00000000, then 11111111...) with a sync after each pass, marks it used, then closes the pack.
+void key_pack_wipe_slot(key_pack pack, int number, shred_report* report)
+{	report->kind   = shred_kind_slot;
+	report->failed = true;
+	if(pack.map == 0) {return;}
+	
+	//Written through the file like a key file (seen in the mapping), then marked used.
+	bool pass_failed = (shred_range(pack.file_descriptor, key_pack_header_size + (number * key_pack_slot_stride), 2000014, report) == false);
+	((key_pack_header*)pack.map)->used[number] = 1;
+	if(msync(pack.map, key_pack_header_size, MS_SYNC) != 0) {pass_failed = true;}
+	key_pack_close(pack);
+	report->failed = pass_failed;
+}
+
+/*##############################################################################
+Size classes. Option 3 sets the largest plainfile the keys are made for: 4,096,
+65,536 or 1,000,000 bytes (v2.2.) Cipherfiles of a class are 7 + class bytes,
+and each key file is carved into pieces twice that size: first half appended
+randomness, second half added, just as a whole key serves a 1MB frame. A 4,096
+class gets 243 files from one key and 65,536 gets 15. A used piece is wiped in
+place; the key is shredded with its last piece. File size.class holds the class
+and goes with the folder, so both sides carve the keys the same way.
+##############################################################################*/
+const long long size_class_default = 1000000; //Without file size.class (v2.2 folders.)
+
+long long size_class_read()
+{	ifstream in_stream;
+	in_stream.open("size.class");
+	long long class_size = 0;
+	if(in_stream.fail() == false) {in_stream >> class_size;}
+	in_stream.close();
+	if((class_size < 1) || (class_size > 1000000)) {class_size = size_class_default;}
+	return class_size;
+}
+
+//Returns false if size.class could not be written.
+bool size_class_write(long long class_size)
+{	ofstream out_stream;
+	out_stream.open("size.class");
+	out_stream << class_size << " bytes per plainfile at most. Do not modify this file. Both sides must have the same.";
+	out_stream.close();
+	return (out_stream.fail() == false);
+}
+
+//Bytes of key one file of class_size uses: appended randomness, then the part added.
+long long size_class_piece_length(long long class_size)
+{	return (2 * (class_size + 7));
+}
+
+//Files one key serves.
+int size_class_pieces(long long class_size)
+{	return (2000014 / size_class_piece_length(class_size));
+}
+
+/*##############################################################################
+Key state. File keys.state holds, in 52 bytes, everything options 1, 2, 5 and 6
+used to rediscover each run: the next key and piece in keys/incoming and in
+keys/outgoing, both remaining counts, the size class, and whether "swapped" and
+"symmetry.entanglement" exist here. One read finds the key to use: no probing 000 - 124,
+no parsing. It is replaced whole (written to keys.state.tmp, synced, renamed)
+so a crash leaves the old or the new state, never half of one. remaining.*.txt
+are still written after each use, for people and for v2.2. A folder without
+keys.state (v2.2, or after removing it) has it rebuilt from those files. Once
+you have changed counters, keys or marker files by hand, remove keys.state.
+##############################################################################*/
+struct key_state
+{	char         magic[8];     //"OTPstate"
+	int          version;      //2
+	int          next_key[2];  //Next key number to use in [0] keys/incoming, [1] keys/outgoing. (Missing files are skipped.)
+	int          next_piece[2];//Next piece of that key (size classes below 1,000,000), else 0.
+	int          remaining[2]; //Counts of [0] remaining.encrypt.txt, [1] remaining.decrypt.txt. (Keys, not pieces.)
+	int          class_size;   //From file size.class.
+	int          swapped;      //1 if file swapped exists.
+	int          entanglement; //1 if file symmetry.entanglement exists, 0 if not, -1 not checked since keygen.
+	unsigned int checksum;     //FNV-1a of all the above.
+};
+
+bool file_exists(const char file_name[])
+{	struct stat file_status;
+	return (stat(file_name, &file_status) == 0);
+}
+
+//Gets the 3-digit count from a remaining.*.txt file, or -1 if it doesn't exist.
+int remaining_read(const char file_name[])
 {	ifstream in_stream;
+	in_stream.open(file_name);
+	if(in_stream.fail() == true) {in_stream.close(); return -1;}
+	char remaining[3];
+	for(int a = 0; a < 3; a++) {in_stream >> remaining[a]; remaining[a] -= 48;}
+	in_stream.close();
+	
+	int remaining_decimal = 0;
+	if(remaining[ 0] > 0) {remaining_decimal += (remaining[ 0] * 100);}
+	if(remaining[ 1] > 0) {remaining_decimal += (remaining[ 1] *  10);}
+	if(remaining[ 2] > 0) {remaining_decimal += (remaining[ 2]      );}
+	return remaining_decimal;
+}
+
+//Returns false if file_name could not be written.
+bool remaining_write(const char file_name[], int remaining_decimal, bool encrypting)
+{	ofstream out_stream;
+	out_stream.open(file_name);
+	if(remaining_decimal < 100) {out_stream << "0";}
+	if(remaining_decimal <  10) {out_stream << "0";}
+	out_stream << remaining_decimal;
+	if(encrypting == true) {out_stream << " files left to encrypt. Do not modify this file. Digits must be 000 - 125";}
+	else                   {out_stream << " files left to decrypt. Do not modify this file. Digits must be 000 - 125";}
+	out_stream.close();
+	return (out_stream.fail() == false);
+}
+
+//Writes "./keys/incoming/000" - "./keys/outgoing/124" to file_name[].
+void key_file_name(char file_name[20], bool outgoing, int number)
+{	if(outgoing == true) {strcpy(file_name, "./keys/outgoing/000");}
+	else                 {strcpy(file_name, "./keys/incoming/000");}
+	file_name[16] = ( number / 100      ) + 48; //       ./keys/outgoing/0  0  0    (file name)
+	file_name[17] = ((number /  10) % 10) + 48; //                       ^  ^  ^
+	file_name[18] = ( number        % 10) + 48; //                      16 17 18    (element layout)
+}
+
+//Gets the number of the first key file that exists (or unused pack slot) from first_number on, or -1 if none.
+int key_probe(bool outgoing, int first_number)
+{	if(key_pack_exists(outgoing) == true) {return key_pack_probe(outgoing, first_number);}
+	char file_name[20];
+	for(int number = first_number; number < 125; number++)
+	{	key_file_name(file_name, outgoing, number);
+		if(file_exists(file_name) == true) {return number;}
+	}
+	return -1;
+}
+
+unsigned int key_state_checksum(const key_state& state)
+{	const unsigned char* bytes = (const unsigned char*)&state;
+	unsigned int hash = 2166136261u;
+	for(unsigned int a = 0; a < offsetof(key_state, checksum); a++) {hash = ((hash ^ bytes[a]) * 16777619u);}
+	return hash;
+}
+
+//Takes keys.lock, waiting for any other process holding it. Returns the descriptor for key_state_unlock() (-1 if the lock can't be had.)
+int key_state_lock()
+{	int file_descriptor = open("keys.lock", (O_RDWR | O_CREAT), 0666);
+	if(file_descriptor < 0) {return -1;}
+	while((flock(file_descriptor, LOCK_EX) != 0) && (errno == EINTR)) {}
+	return file_descriptor;
+}
+
+void key_state_unlock(int file_descriptor)
+{	if(file_descriptor < 0) {return;}
+	flock(file_descriptor, LOCK_UN);
+	close(file_descriptor);
+}
+
+key_state* key_state_mirror = 0; //This folder's record in channels.registry (--peer=ID), kept equal to keys.state. See Channel registry.
+
+//Writes keys.state.tmp, syncs it, renames it over keys.state and syncs the folder so the rename lasts too (then its copy in
+//channels.registry, if any.) Returns false if any of it fails.
+bool key_state_save(key_state& state)
+{	memcpy(state.magic, "OTPstate", 8);
+	state.version  = 2;
+	state.checksum = key_state_checksum(state);
+	
+	int file_descriptor = open("keys.state.tmp", (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+	if(file_descriptor < 0) {return false;}
+	bool written = (write(file_descriptor, &state, sizeof(state)) == (ssize_t)sizeof(state));
+	if(fsync(file_descriptor) != 0) {written = false;}
+	close(file_descriptor);
+	if(written == false) {remove("keys.state.tmp"); return false;}
+	if(rename("keys.state.tmp", "keys.state") != 0) {return false;}
+	int folder = open(".", (O_RDONLY | O_DIRECTORY));
+	if(folder < 0) {return false;}
+	bool synced = (fsync(folder) == 0);
+	close(folder);
+	if(key_state_mirror != 0) {*key_state_mirror = state;}
+	return synced;
+}
+
+//Fresh state for a new key folder (option 3.)
+void key_state_new(key_state& state)
+{	memset(&state, 0, sizeof(state));
+	state.next_key [0] =   0;
+	state.next_key [1] =   0;
+	state.remaining[0] = 125;
+	state.remaining[1] = 125;
+	state.class_size   = size_class_read();
+	state.swapped      =   0;
+	state.entanglement =  -1; //The key maker removes symmetry.entanglement by hand after sharing, so it is checked at first use.
+}
+
+//Returns true if any 64-byte block of piece[] is all zeros or all ones. A random key never has one (1 in 2^500), a piece that is
+//wiped, or whose wipe was cut short, always does. Such a piece is never used: mod 256 addition of zeros leaves the file as it is.
+bool key_piece_blank(const unsigned char piece[], long long length)
+{	for(long long a = 0; (a + 64) <= length; a += 64)
+	{	unsigned long long words[8], ored = 0, anded = ~0ULL;
+		memcpy(words, piece + a, 64);
+		for(int b = 0; b < 8; b++) {ored |= words[b]; anded &= words[b];}
+		if((ored == 0) || (anded == ~0ULL)) {return true;}
+	}
+	return false;
+}
+
+//Gets how many pieces from the start of a key are already wiped (see key_piece_blank()), which is where the next file starts.
+int key_pieces_wiped(bool outgoing, int number, long long class_size)
+{	long long piece_length = size_class_piece_length(class_size);
+	int pieces = size_class_pieces(class_size);
+	if(pieces == 1) {return 0;}
+	
+	char file_name[32];
+	long long offset = 0;
+	if(key_pack_exists(outgoing) == true) {strcpy(file_name, key_pack_name(outgoing)); offset = (key_pack_header_size + (number * key_pack_slot_stride));}
+	else                                  {key_file_name(file_name, outgoing, number);}
+	int file_descriptor = open(file_name, O_RDONLY);
+	if(file_descriptor < 0) {return 0;}
+	
+	vector<unsigned char> piece(piece_length);
+	int wiped = 0;
+	for(; wiped < pieces; wiped++)
+	{	if(pread(file_descriptor, piece.data(), piece_length, offset + (wiped * piece_length)) != piece_length) {break;}
+		if(key_piece_blank(piece.data(), piece_length) == false) {break;}
+	}
+	close(file_descriptor);
+	if(wiped == pieces) {wiped = 0;} //Shredding of the whole key was cut short: the probe has skipped it anyway.
+	return wiped;
+}
+
+//Gets state from the v2.2 files. Returns false if there are no keys here.
+bool key_state_rebuild(key_state& state)
+{	memset(&state, 0, sizeof(state));
+	state.remaining[0] = remaining_read("remaining.encrypt.txt");
+	state.remaining[1] = remaining_read("remaining.decrypt.txt");
+	if((state.remaining[0] == -1) || (state.remaining[1] == -1)) {return false;}
+	state.class_size   = size_class_read();
+	state.swapped      = file_exists("swapped"              );
+	state.entanglement = file_exists("symmetry.entanglement");
+	for(int folder = 0; folder < 2; folder++)
+	{	state.next_key[folder] = key_probe((folder == 1), 0);
+		if(state.next_key[folder] == -1) {state.next_key[folder] = 125; continue;}
+		state.next_piece[folder] = key_pieces_wiped((folder == 1), state.next_key[folder], state.class_size);
+	}
+	return true;
+}
+
+//Reads keys.state as it is. Returns false if it's missing or damaged.
+bool key_state_read(key_state& state)
+{	int file_descriptor = open("keys.state", O_RDONLY);
+	if(file_descriptor < 0) {return false;}
+	bool valid = (read(file_descriptor, &state, sizeof(state)) == (ssize_t)sizeof(state));
+	close(file_descriptor);
+	return ((valid == true) && (memcmp(state.magic, "OTPstate", 8) == 0) && (state.version == 2) && (state.checksum == key_state_checksum(state)));
+}
+
+//Reads keys.state (or rebuilds it.) Returns false if there are no keys here.
+bool key_state_load(key_state& state)
+{	if((key_state_read(state) == true) && (state.entanglement != -1)) {return true;}
+	
+	int lock = key_state_lock(); //Another process may be rebuilding it too.
+	bool loaded = key_state_read(state);
+	if(loaded == false)
+	{	loaded = key_state_rebuild(state);
+		if(loaded == true) {key_state_save(state);}
+	}
+	if((loaded == true) && (state.entanglement == -1))
+	{	state.entanglement = file_exists("symmetry.entanglement");
+		key_state_save(state);
+	}
+	key_state_unlock(lock);
+	return loaded;
+}
+
+//Which remaining count an encrypt or decrypt uses: [0] encrypt and [1] decrypt, or the other way around when swapped.
+int key_state_remaining_slot(const key_state& state, bool encrypting)
+{	if(encrypting != (state.swapped == 1)) {return 0;}
+	else                                   {return 1;}
+}
+
+//Maintaining symmetry entanglement: the side holding symmetry.entanglement encrypts with outgoing and decrypts with incoming.
+bool key_state_outgoing(const key_state& state, bool encrypting)
+{	return (encrypting == (state.entanglement == 1));
+}
+
+//Gets the next key and piece of a folder as one position: key number * pieces per key + piece.
+long long key_state_position(const key_state& state, bool outgoing)
+{	return ((state.next_key[outgoing] * (long long)size_class_pieces(state.class_size)) + state.next_piece[outgoing]);
+}
+
+//Gets the files left to encrypt or decrypt: keys left times pieces per key, less the pieces of the next key already used.
+int key_state_files_left(const key_state& state, bool encrypting)
+{	int keys_left = state.remaining[key_state_remaining_slot(state, encrypting)];
+	if(keys_left <= 0) {return 0;}
+	return ((keys_left * size_class_pieces(state.class_size)) - state.next_piece[key_state_outgoing(state, encrypting)]);
+}
+
+//Records keys used: the remaining count drops by keys_used (whole keys), and the next position becomes next_position if that's
+//later (or if rewinding: keys given back.) Re-reads keys.state under keys.lock first, so other processes' counts stay. Writes
+//keys.state, then remaining.*.txt. Returns false if either could not be written (see key_state_commit_warn().)
+bool key_state_commit(key_state& state, bool encrypting, long long next_position, int keys_used, bool rewinding)
+{	int lock = key_state_lock();
+	key_state on_disk;
+	if(key_state_read(on_disk) == true) {state = on_disk;}
+	
+	int  slot     = key_state_remaining_slot(state, encrypting);
+	bool outgoing = key_state_outgoing(state, encrypting);
+	int  pieces   = size_class_pieces(state.class_size);
+	if((rewinding == true) || (next_position > key_state_position(state, outgoing)))
+	{	state.next_key  [outgoing] = (next_position / pieces);
+		state.next_piece[outgoing] = (next_position % pieces);
+	}
+	state.remaining[slot] -= keys_used;
+	bool committed = key_state_save(state);
+	
+	if(slot == 0) {if(remaining_write("remaining.encrypt.txt", state.remaining[slot], encrypting) == false) {committed = false;}}
+	else          {if(remaining_write("remaining.decrypt.txt", state.remaining[slot], encrypting) == false) {committed = false;}}
+	key_state_unlock(lock);
+	return committed;
+}
+
+//Says a commit failed. The key is used up all the same (it can't come back), but the count of files left may now be off by it.
+void key_state_commit_warn()
+{	cout << "\n\nkeys.state or the remaining counter could not be written (disk full?) The used key is gone all the same, but\n"
+	     << "the count of files left here may be off by it: free some space, then compare with the other side (option 9.)\n";
+}
+
+/*##############################################################################
+Key reservation. Several processes may encrypt or decrypt from one folder at
+once. Each takes its key (or key piece) from a counter in file keys.reserve,
+which every process maps into memory: one compare-and-swap moves the counter
+past the position taken, so no two processes get the same key and none waits
+on another to get one. A position is key number * pieces per key + piece. The
+bookkeeping after use (keys.state, remaining.*.txt) is brief and done by one
+process at a time under keys.lock, which is also the fallback where mmap() is
+not possible. Keys given back (a cancelled batch) return to the counter only if
+no other process has taken a later one meanwhile. --export marks both counters
+with key_reserve_paused while it runs: a reservation that meets the mark waits
+for keys.lock, which the export holds, and clears the mark if it's still there
+(an export that stopped midway.)
+##############################################################################*/
+struct key_reservations
+{	char      magic[8];         //"OTPresv1"
+	long long next_position[2]; //[0] keys/incoming, [1] keys/outgoing.
+};
+
+const long long key_reserve_paused = (1LL << 62); //Added to both counters by --export, see archive_export().
+
+key_reservations* key_reserve_mapping = 0; //keys.reserve of the folder in use, mapped at its first reservation. (Each library store has its own, see Library.)
+mutex             key_reserve_mapping_lock;  //Batch, daemon and library threads may reserve at once.
+
+//Makes keys.reserve from keys.state if it's missing. Then maps it, or returns 0 (the caller falls back to keys.lock.)
+key_reservations* key_reserve_map(const key_state& state)
+{	lock_guard<mutex> hold(key_reserve_mapping_lock);
+	if(key_reserve_mapping != 0) {return key_reserve_mapping;}
+	
+	if(block_file_size("keys.reserve") != 4096)
+	{	int lock = key_state_lock();
+		if(block_file_size("keys.reserve") != 4096)
+		{	unsigned char page[4096] = {0};
+			key_reservations* fresh = (key_reservations*)page;
+			memcpy(fresh->magic, "OTPresv1", 8);
+			fresh->next_position[0] = key_state_position(state, false);
+			fresh->next_position[1] = key_state_position(state,  true);
+			if(block_write_file("keys.reserve.tmp", page, 4096) == true) {rename("keys.reserve.tmp", "keys.reserve");}
+		}
+		key_state_unlock(lock);
+	}
+	
+	int file_descriptor = open("keys.reserve", O_RDWR);
+	if(file_descriptor < 0) {return 0;}
+	void* map = mmap(0, 4096, (PROT_READ | PROT_WRITE), MAP_SHARED, file_descriptor, 0);
+	close(file_descriptor);
+	if(map == MAP_FAILED) {return 0;}
+	if(memcmp(map, "OTPresv1", 8) != 0) {munmap(map, 4096); return 0;}
+	key_reserve_mapping = (key_reservations*)map;
+	return key_reserve_mapping;
+}
+
+//Gets the first position from position on whose key file (or pack slot) exists, or -1 if none.
+long long key_reserve_existing(const key_state& state, bool outgoing, long long position)
+{	int pieces = size_class_pieces(state.class_size);
+	if(position < key_state_position(state, outgoing)) {position = key_state_position(state, outgoing);} //keys.reserve behind keys.state (lost in a power cut, say.)
+	int key_number = key_probe(outgoing, (position / pieces));
+	if(key_number == -1) {return -1;}
+	if(key_number != (position / pieces)) {position = (key_number * (long long)pieces);} //Missing key files are skipped.
+	return position;
+}
+
+//Takes the next key (or key piece) for an encrypt or decrypt, for this process only. Returns its position, or -1 if none are left.
+long long key_reserve(const key_state& state, bool encrypting)
+{	bool outgoing = key_state_outgoing(state, encrypting);
+	key_reservations* reservations = key_reserve_map(state);
+	if(reservations != 0)
+	{	long long* counter = &reservations->next_position[outgoing];
+		long long current = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+		for(;;)
+		{	if((current & key_reserve_paused) != 0)
+			{	int lock = key_state_lock(); //Waits out the export.
+				__atomic_fetch_and(counter, ~key_reserve_paused, __ATOMIC_ACQ_REL);
+				key_state_unlock(lock);
+				current = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+				continue;
+			}
+			long long position = key_reserve_existing(state, outgoing, current);
+			if(position == -1) {return -1;}
+			if(__atomic_compare_exchange_n(counter, &current, position + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == true) {return position;}
+			//Another process moved the counter first: current now holds where it went, try from there.
+		}
+	}
+	
+	//Fallback: the same counter, read and written under keys.lock.
+	int lock = key_state_lock();
+	int file_descriptor = open("keys.reserve", (O_RDWR | O_CREAT), 0666);
+	key_reservations on_disk;
+	if(pread(file_descriptor, &on_disk, sizeof(on_disk), 0) != (ssize_t)sizeof(on_disk)) {memset(&on_disk, 0, sizeof(on_disk)); memcpy(on_disk.magic, "OTPresv1", 8);}
+	on_disk.next_position[outgoing] &= ~key_reserve_paused; //Left by an export that stopped midway: no export runs while this holds keys.lock.
+	long long position = key_reserve_existing(state, outgoing, on_disk.next_position[outgoing]);
+	if(position != -1)
+	{	on_disk.next_position[outgoing] = (position + 1);
+		if(pwrite(file_descriptor, &on_disk, sizeof(on_disk), 0) != (ssize_t)sizeof(on_disk)) {position = -1;}
+	}
+	if(file_descriptor >= 0) {close(file_descriptor);}
+	key_state_unlock(lock);
+	return position;
+}
+
+//Gives back positions first to end - 1, unused after all, if no other process has taken a later one. Returns false if they stay taken.
+bool key_unreserve(const key_state& state, bool encrypting, long long first, long long end)
+{	bool outgoing = key_state_outgoing(state, encrypting);
+	key_reservations* reservations = key_reserve_map(state);
+	if(reservations != 0)
+	{	long long expected = end;
+		return __atomic_compare_exchange_n(&reservations->next_position[outgoing], &expected, first, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	}
+	
+	int lock = key_state_lock();
+	bool given_back = false;
+	int file_descriptor = open("keys.reserve", O_RDWR);
+	key_reservations on_disk;
+	if((file_descriptor >= 0) && (pread(file_descriptor, &on_disk, sizeof(on_disk), 0) == (ssize_t)sizeof(on_disk)) && (on_disk.next_position[outgoing] == end))
+	{	on_disk.next_position[outgoing] = first;
+		given_back = (pwrite(file_descriptor, &on_disk, sizeof(on_disk), 0) == (ssize_t)sizeof(on_disk));
+	}
+	if(file_descriptor >= 0) {close(file_descriptor);}
+	key_state_unlock(lock);
+	return given_back;
+}
+
+//Holds back reservations in every process while the caller holds keys.lock: marks both counters in keys.reserve with
+//key_reserve_paused and puts where they were in positions[] (-1 if there's no keys.reserve, so no reservations yet.) Returns
+//the mapping for key_reserve_resume(), or 0 if it can't be mapped (then reservations take keys.lock anyway.)
+key_reservations* key_reserve_pause(long long positions[2])
+{	positions[0] = -1;
+	positions[1] = -1;
+	int file_descriptor = open("keys.reserve", O_RDWR);
+	if(file_descriptor < 0) {return 0;}
+	void* map = mmap(0, 4096, (PROT_READ | PROT_WRITE), MAP_SHARED, file_descriptor, 0);
+	close(file_descriptor);
+	if(map == MAP_FAILED) {return 0;}
+	if(memcmp(map, "OTPresv1", 8) != 0) {munmap(map, 4096); return 0;}
+	key_reservations* reservations = (key_reservations*)map;
+	for(int folder = 0; folder < 2; folder++)
+	{	positions[folder] = (__atomic_fetch_or(&reservations->next_position[folder], key_reserve_paused, __ATOMIC_ACQ_REL) & ~key_reserve_paused);
+	}
+	return reservations;
+}
+
+//Lets reservations go on (before keys.lock is given up.)
+void key_reserve_resume(key_reservations* reservations)
+{	if(reservations == 0) {return;}
+	for(int folder = 0; folder < 2; folder++) {__atomic_fetch_and(&reservations->next_position[folder], ~key_reserve_paused, __ATOMIC_ACQ_REL);}
+	munmap(reservations, 4096);
+}
+
+/*##############################################################################
+Channel registry (schemeOTP --add-peer=ID, --peer=ID, --channels.) One folder
+holds the key folders of many peers: peers/ID for each, made by --add-peer=ID.
+Run with --peer=ID, the program does all it does (menu, daemon) in peers/ID as
+if started there, and only that. File channels.registry, mapped into memory by
+every process, is a hash table of peer IDs: finding a peer is one hash and a
+probe or two, however many there are. Each entry also holds a copy of the peer
+folder's keys.state, written whenever keys.state is, so --channels lists every
+channel's keys left, size class and swap state in one scan of one file, and
+flags the ones depleted or running low, with no peer folder opened at all. The
+library opens peers the same way (otp_store_open_peer()), as many as it likes
+in one process, each with its own keys.reserve mapping (see Library.)
+##############################################################################*/
+const int channel_registry_slots = 4096; //Peers at most. The table is kept under half full for short probes.
+const int channel_low_keys       =   10; //--channels flags a way with fewer keys left.
+
+struct channel_record
+{	char      peer[48]; //Peer ID, 0-terminated. "" = free.
+	key_state state;    //Copy of peers/<ID>/keys.state. All 0 until keys are made or copied there and it is run.
+};
+
+struct channel_registry_header
+{	char magic[8];      //"OTPchan1"
+	int  slots;         //channel_registry_slots
+	int  count;         //Peers registered.
+};
+
+struct channel_registry
+{	int                      file_descriptor;
+	channel_registry_header* header;
+	channel_record*          records; //After the 4096-byte header page.
+};
+
+const long long channel_registry_length = (4096 + (channel_registry_slots * (long long)sizeof(channel_record)));
+
+//Peer IDs are names of folders: 1 - 47 letters, digits, '.', '-' or '_', not starting with '.'.
+bool channel_peer_valid(const char peer[])
+{	int length = strlen(peer);
+	if((length < 1) || (length > 47) || (peer[0] == '.')) {return false;}
+	for(int a = 0; a < length; a++)
+	{	if((isalnum((unsigned char)peer[a]) == 0) && (peer[a] != '.') && (peer[a] != '-') && (peer[a] != '_')) {return false;}
+	}
+	return true;
+}
+
+//Maps channels.registry here, making it first if asked. Returns false if it's missing (and not made) or not a registry.
+bool channel_registry_map(channel_registry& registry, bool create)
+{	long long map_length = channel_registry_length;
+	registry.header = 0;
+	registry.file_descriptor = open("channels.registry", (create == true) ? (O_RDWR | O_CREAT) : O_RDWR, 0666);
+	if(registry.file_descriptor < 0) {return false;}
+	while((flock(registry.file_descriptor, LOCK_EX) != 0) && (errno == EINTR)) {}
+	bool fresh = (block_file_size("channels.registry") == 0);
+	if((fresh == true) && (ftruncate(registry.file_descriptor, map_length) != 0)) {close(registry.file_descriptor); return false;}
+	
+	void* map = MAP_FAILED;
+	if(block_file_size("channels.registry") == map_length) {map = mmap(0, map_length, (PROT_READ | PROT_WRITE), MAP_SHARED, registry.file_descriptor, 0);}
+	if(map != MAP_FAILED)
+	{	registry.header  = (channel_registry_header*)map;
+		registry.records = (channel_record*)((unsigned char*)map + 4096);
+		if(fresh == true) {memcpy(registry.header->magic, "OTPchan1", 8); registry.header->slots = channel_registry_slots;}
+		if((memcmp(registry.header->magic, "OTPchan1", 8) != 0) || (registry.header->slots != channel_registry_slots)) {munmap(map, map_length); registry.header = 0;}
+	}
+	flock(registry.file_descriptor, LOCK_UN);
+	if(registry.header == 0) {close(registry.file_descriptor); return false;}
+	return true;
+}
+
+//Finds the record of peer, or else the free slot where it would go (peer[0] == 0 there), or 0 if the table is full.
+channel_record* channel_find(const channel_registry& registry, const char peer[])
+{	unsigned int hash = 2166136261u;
+	for(int a = 0; peer[a] != 0; a++) {hash = ((hash ^ (unsigned char)peer[a]) * 16777619u);}
+	for(int probe = 0; probe < channel_registry_slots; probe++)
+	{	channel_record* record = &registry.records[(hash + probe) % channel_registry_slots];
+		if((record->peer[0] == 0) || (strcmp(record->peer, peer) == 0)) {return record;}
+	}
+	return 0;
+}
+
+void channel_registry_unmap(channel_registry& registry)
+{	if(registry.header == 0) {return;}
+	munmap(registry.header, channel_registry_length);
+	close(registry.file_descriptor);
+	registry.header = 0;
+}
+
+//Registers peer (a valid ID) and makes its folder peers/<ID>. Returns 1 if added, 0 if registered already, -1 if the registry
+//can't be made or is damaged, -2 if it's full.
+int channel_register(const char peer[])
+{	channel_registry registry;
+	if(channel_registry_map(registry, true) == false) {return -1;}
+	
+	while((flock(registry.file_descriptor, LOCK_EX) != 0) && (errno == EINTR)) {}
+	channel_record* record = channel_find(registry, peer);
+	int registered = -2;
+	if((record != 0) && (record->peer[0] != 0)) {registered = 0;}
+	else if((record != 0) && (registry.header->count < (channel_registry_slots / 2)))
+	{	memset(record, 0, sizeof(channel_record));
+		strcpy(record->peer, peer);
+		registry.header->count++;
+		registered = 1;
+	}
+	flock(registry.file_descriptor, LOCK_UN);
+	channel_registry_unmap(registry);
+	
+	mkdir("peers", 0777);
+	string folder = string("peers/") + peer;
+	mkdir(folder.c_str(), 0777);
+	return registered;
+}
+
+//Registers peer and makes its folder peers/<ID> (keys then go there: option 3 with --peer=ID, or a copy of a shared folder.)
+bool channel_add(const char peer[])
+{	if(channel_peer_valid(peer) == false) {cout << "\nPeer ID must be 1 - 47 letters, digits, '.', '-' or '_', not starting with '.'.\n"; return false;}
+	int registered = channel_register(peer);
+	string folder = string("peers/") + peer;
+	if     (registered ==  1) {cout << "\nPeer " << peer << " registered. Its keys go in folder " << folder << ".\n";}
+	else if(registered ==  0) {cout << "\nPeer " << peer << " is registered already (folder " << folder << ".)\n";}
+	else if(registered == -1) {cout << "\nchannels.registry could not be made or is damaged.\n";}
+	else                      {cout << "\nchannels.registry is full (" << (channel_registry_slots / 2) << " peers.)\n";}
+	return (registered == 1);
+}
+
+//Enters peers/<ID> for the rest of the run, and keeps its registry record in step with keys.state from now on.
+bool channel_enter(const char peer[])
+{	channel_registry registry;
+	if(channel_registry_map(registry, false) == false) {cout << "\nNo channels.registry here, add a peer first (--add-peer=ID.)\n"; return false;}
+	channel_record* record = channel_find(registry, peer);
+	if((record == 0) || (record->peer[0] == 0)) {cout << "\nNo peer " << peer << " in channels.registry.\n"; return false;}
+	
+	string folder = string("peers/") + peer;
+	if(chdir(folder.c_str()) != 0) {cout << "\nFolder " << folder << " is missing.\n"; return false;}
+	key_state_mirror = &record->state;
+	key_state state;
+	if(key_state_read(state) == true) {*key_state_mirror = state;} //Keys copied in, or used by a run without --peer.
+	return true;
+}
+
+//Lists every channel from channels.registry alone, flagging the depleted and those low on keys.
+int channel_list()
+{	channel_registry registry;
+	if(channel_registry_map(registry, false) == false) {cout << "\nNo channels.registry here, add a peer first (--add-peer=ID.)\n"; return 1;}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	int peers = 0, depleted = 0, low = 0, unseen = 0;
+	cout << "\nPeer                                             Encrypt  Decrypt  Class    Swapped\n";
+	for(int a = 0; a < channel_registry_slots; a++)
+	{	const channel_record& record = registry.records[a];
+		if(record.peer[0] == 0) {continue;}
+		peers++;
+		cout << record.peer << string(49 - strlen(record.peer), ' ');
+		key_state state = record.state;
+		if((memcmp(state.magic, "OTPstate", 8) != 0) || (state.checksum != key_state_checksum(state))) {cout << "(no keys.state seen yet)\n"; unseen++; continue;}
+		
+		int files_left[2] = {key_state_files_left(state, true), key_state_files_left(state, false)};
+		char line[64];
+		snprintf(line, sizeof(line), "%7d  %7d  %-7d  %s", files_left[0], files_left[1], state.class_size, (state.swapped == 1) ? "yes" : "no");
+		cout << line;
+		int keys_left = min(state.remaining[0], state.remaining[1]);
+		if     (keys_left <= 0              ) {cout << "  DEPLETED"; depleted++;}
+		else if(keys_left <  channel_low_keys) {cout << "  low"     ; low++     ;}
+		if(state.entanglement == -1) {cout << "  (not yet run since keygen)";}
+		cout << "\n";
+	}
+	double milliseconds = (chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1000);
+	cout << "\n" << peers << " channels: " << depleted << " depleted, " << low << " low (under " << channel_low_keys << " keys one way), "
+	     << unseen << " without keys.state seen. Scanned in " << ((int)(milliseconds * 10) / 10.0) << "ms.\n";
+	return 0;
+}
+
+//One key (or one piece of it, see size classes), from its own file or from a pack slot.
+struct key_slot
+{	char                 name[32];     //"./keys/outgoing/000" or "./keys/outgoing.pack slot 000", for messages and shredding.
+	bool                 outgoing;
+	int                  number;
+	int                  piece;
+	long long            piece_length; //2,000,014 for the whole key (size class 1,000,000.)
+	key_pack             pack;         //Mapped while a pack slot is loaded.
+	const unsigned char* bytes;        //The piece: in the pack mapping, or in the buffer given to key_load().
+};
+
+void key_slot_set(key_slot& key, bool outgoing, int number, int piece, long long class_size)
+{	key_file_name(key.name, outgoing, number);
+	if(key_pack_exists(outgoing) == true)
+	{	char digits[4] = {key.name[16], key.name[17], key.name[18], 0};
+		strcpy(key.name, key_pack_name(outgoing));
+		strcat(key.name, " slot ");
+		strcat(key.name, digits);
+	}
+	key.outgoing     = outgoing;
+	key.number       = number;
+	key.piece        = piece;
+	key.piece_length = size_class_piece_length(class_size);
+	if(size_class_pieces(class_size) == 1) {key.piece_length = 2000014;}
+	key.pack.map     = 0;
+	key.bytes        = 0;
+}
+
+//Gets the key piece: a pointer into its pack (no copy), or else read from its file into buffer[]. Returns false if missing, used,
+//damaged or blank (wiped in part, see key_piece_blank().)
+bool key_load(key_slot& key, unsigned char buffer[2000014])
+{	long long offset = (key.piece * key.piece_length);
+	if(key_pack_exists(key.outgoing) == false)
+	{	key.bytes = buffer;
+		bool loaded = false;
+		if(key.piece_length == 2000014) {loaded = (block_read_file(key.name, buffer, 2000014) == 2000014);}
+		else
+		{	int file_descriptor = open(key.name, O_RDONLY);
+			if(file_descriptor < 0) {return false;}
+			loaded = (pread(file_descriptor, buffer, key.piece_length, offset) == key.piece_length);
+			close(file_descriptor);
+		}
+		return ((loaded == true) && (key_piece_blank(buffer, key.piece_length) == false));
+	}
+	if(key_pack_open(key.pack, key.outgoing) == false) {return false;}
+	if(key_pack_slot_used(key.pack, key.number) == true) {key_pack_close(key.pack); return false;}
+	key.bytes = (key_pack_slot(key.pack, key.number) + offset);
+	unsigned char* first_page = (unsigned char*)(((unsigned long long)key.bytes) & ~4095ULL);
+	madvise(first_page, (key.bytes + key.piece_length) - first_page, MADV_WILLNEED); //Starts reading the piece from disk now.
+	if(key_piece_blank(key.bytes, key.piece_length) == true) {key_pack_close(key.pack); key.bytes = 0; return false;}
+	return true;
+}
+
+//Same as key_load(), but reads the key file only from byte skip_length of the piece on, at the same time as length bytes of
+//input_name go to input[]. (Encrypt and decrypt read the file over the key's first bytes anyway.) Returns false if either fails.
+bool key_load_with_input(key_slot& key, unsigned char buffer[2000014], long long skip_length, const char input_name[], unsigned char input[], long long length)
+{	if(key_pack_exists(key.outgoing) == true) {return ((key_load(key, buffer) == true) && (block_read_file(input_name, input, length) == length));}
+	key.bytes = buffer;
+	io_request reads[2];
+	reads[0].operation       = io_read;
+	reads[0].file_descriptor = open(key.name, O_RDONLY);
+	reads[0].buffer          = (buffer + skip_length);
+	reads[0].length          = (key.piece_length - skip_length);
+	reads[0].offset          = ((key.piece * key.piece_length) + skip_length);
+	reads[1].operation       = io_read;
+	reads[1].file_descriptor = open(input_name, O_RDONLY);
+	reads[1].buffer          = input;
+	reads[1].length          = length;
+	reads[1].offset          = 0;
+	bool loaded = ((reads[0].file_descriptor >= 0) && (reads[1].file_descriptor >= 0) && (io_submit_all(reads, 2) == true));
+	if(reads[0].file_descriptor >= 0) {close(reads[0].file_descriptor);}
+	if(reads[1].file_descriptor >= 0) {close(reads[1].file_descriptor);}
+	return ((loaded == true) && (key_piece_blank(buffer + skip_length, key.piece_length - skip_length) == false));
+}
+
+//Lets go of a loaded key that was not used after all.
+void key_release(key_slot& key)
+{	key_pack_close(key.pack);
+	key.bytes = 0;
+}
+
+//Shreds a whole used key file, or wipes a whole used pack slot in place, on a new thread. (The caller joins it.)
+thread key_consume_async(key_slot& key, shred_report* report)
+{	key.bytes = 0;
+	if(key_pack_exists(key.outgoing) == false) {return shred_file_async(key.name, report);}
+	key_pack pack = key.pack;
+	key.pack.map = 0; //The wiping thread closes the pack.
+	if(pack.map == 0) {key_pack_open(pack, key.outgoing);} //Released after loading (batch mode), or never loaded.
+	return thread(key_pack_wipe_slot, pack, key.number, report);
+}
+
+//Overwrites only the used piece of a key in place, twice with a sync after each pass. Its other pieces stay for later files.
+//file_descriptor is the pack's, or the key file's (opened by the caller, in the key's folder.)
+void key_wipe_piece(key_slot key, int file_descriptor, shred_report* report)
+{	report->kind   = shred_kind_piece;
+	report->failed = true;
+	long long offset = (key.piece * key.piece_length);
+	if(key.pack.map != 0) {offset += (key_pack_header_size + (key.number * key_pack_slot_stride));} //Written through the file, seen in the mapping.
+	if(file_descriptor < 0) {return;}
+	
+	bool wiped = shred_range(file_descriptor, offset, key.piece_length, report);
+	if(key.pack.map != 0) {key_pack_close(key.pack);}
+	else                  {close(file_descriptor);}
+	report->failed = (wiped == false);
+}
+
+//Wipes a used piece on a new thread. (The caller joins it.) The last piece of a key goes to key_consume_async() instead.
+thread key_consume_piece_async(key_slot& key, shred_report* report)
+{	key_slot used_piece = key;
+	key.bytes    = 0;
+	key.pack.map = 0; //The wiping thread closes the pack.
+	int file_descriptor = used_piece.pack.file_descriptor;
+	if(used_piece.pack.map == 0) {file_descriptor = open(used_piece.name, O_WRONLY);}
+	return thread(key_wipe_piece, used_piece, file_descriptor, report);
+}
+
+/*##############################################################################
+Frames. A frame is what one key file encrypts: 7 digits of file size, the file,
+then the key's own first half as appended randomness, to 1,000,007 bytes. The
+key file is loaded into frame[] first and the file read over it at frame[7]. A
+pack slot is not loaded: key[] points into the pack, frame[] is a separate array
+and only the appended randomness is copied from key[]. In a smaller size class
+the frame is 7 + class_size bytes and key[] is one piece (twice that) instead.
+##############################################################################*/
+//Writes the file size to the first 7 frame[] elements and encrypts frame[] using the key's second half. frame[] may be key[].
+//Compressed: the file bytes are packed (see Compression), flagged by the top bit of the first digit.
+void frame_encrypt(unsigned char frame[], const unsigned char key[], long long file_size, long long class_size, bool compressed)
+{	if(frame != key) {memcpy(frame + 7 + file_size, key + 7 + file_size, class_size - file_size);} //Appended randomness.
+	
+	file_size += 1000000000;
+	for(int a = 6; a >= 0; a--)
+	{	frame[a] = (file_size % 10);
+		file_size /= 10;
+	}
+	if(compressed == true) {frame[0] |= 0x80;}
+	
+	cipher_add_bytes(frame, frame, key + class_size + 7, class_size + 7);
+}
+
+//Gets the file size from the first 7 elements of a decrypted frame[] (and whether the file bytes are packed.) Clears the flag.
+long long frame_file_size(unsigned char frame[], long long class_size, bool* compressed)
+{	*compressed = ((frame[0] & 0x80) != 0);
+	frame[0] &= 0x7F;
+	long long extracted_file_size = 0;
+	for(int a = 0; a < 7; a++) {extracted_file_size = ((extracted_file_size * 10) + frame[a]);}
+	if(extracted_file_size > class_size) {extracted_file_size = class_size;} //Wrong key or damaged cipherfile.
+	return extracted_file_size;
+}
+
+//Decrypts the cipherfile in frame[] (7 + class_size bytes) using the key's second half, and gets the file size from its first 7 elements
+//(and whether the file bytes are packed.)
+long long frame_decrypt(unsigned char frame[], const unsigned char key[], long long class_size, bool* compressed)
+{	/*_____________________________________________ ________________________________________________
+	|                                              |                                                |
+	|          if sub-key <= cipherfile            |                     else                       |
+	|   then plainfile = (cipherfile - sub-key)    |    plainfile = ((256 - sub-key) + cipherfile)  |
+	|______________________________________________|_______________________________________________*/
+	cipher_subtract_bytes(frame, frame, key + class_size + 7, class_size + 7); //Both cases at once: unsigned char wraps.
+	return frame_file_size(frame, class_size, compressed);
+}
+
+/*##############################################################################
+Compression (schemeOTP --compress, option 1.) Text and office files shrink 3-10
+times, and a frame holds class_size bytes however well they'd shrink, so with
+--compress option 1 first packs plainfile (up to compress_max_expanded bytes)
+and stores that instead whenever it's smaller. A set top bit in the frame's
+first size digit says so; decryption (options 2 and 6, and the daemon) expands
+such a frame back. The flag is encrypted with the size. A frame whose bytes do
+not expand (wrong key, damaged cipherfile) is written out as it is, just as a
+wrong key always gave some file. The format is LZ4-like: sequences of a token
+(literal count, match length less 4), literals, a 2-byte distance back and the
+match; counts of 15 go on in bytes of 255. First come 4 bytes of file size. A
+v2.2 program can't read compressed frames: use --compress only when both can.
+##############################################################################*/
+const long long compress_max_expanded = 64000000; //Largest plainfile packed, and largest a frame may expand to.
+const int       compress_hash_bits    =       16;
+
+//Gets the most bytes compress_bytes() may write for length bytes.
+long long compress_bound(long long length)
+{	return (4 + length + (length / 255) + 16);
+}
+
+//Writes a count of 15 or more on in bytes of 255, after the 15 in the token.
+unsigned char* compress_put_count(unsigned char* out, long long count)
+{	for(count -= 15; count >= 255; count -= 255) {*out++ = 255;}
+	*out++ = count;
+	return out;
+}
+
+unsigned char* compress_put_sequence(unsigned char* out, const unsigned char literals[], long long literal_count, long long distance, long long match_length)
+{	unsigned char* token = out++;
+	*token = (((literal_count < 15) ? literal_count : 15) << 4);
+	if(literal_count >= 15) {out = compress_put_count(out, literal_count);}
+	memcpy(out, literals, literal_count);
+	out += literal_count;
+	if(match_length == 0) {return out;} //Last sequence: literals only.
+	
+	*out++ = (distance & 255);
+	*out++ = (distance >> 8);
+	*token |= (((match_length - 4) < 15) ? (match_length - 4) : 15);
+	if((match_length - 4) >= 15) {out = compress_put_count(out, match_length - 4);}
+	return out;
+}
+
+//Packs length bytes of in[] to out[] (compress_bound(length) bytes.) Returns the packed length.
+long long compress_bytes(const unsigned char in[], long long length, unsigned char out[])
+{	for(int a = 0; a < 4; a++) {out[a] = (length >> (a * 8));}
+	unsigned char* put = (out + 4);
+	vector<long long> last_seen((1 << compress_hash_bits), -1); //Where each hashed 4 bytes were seen last.
+	long long anchor = 0; //First literal not yet written.
+	long long a = 0;
+	while((a + 4) <= length)
+	{	unsigned int four_bytes;
+		memcpy(&four_bytes, in + a, 4);
+		unsigned int hash = ((four_bytes * 2654435761u) >> (32 - compress_hash_bits));
+		long long candidate = last_seen[hash];
+		last_seen[hash] = a;
+		if((candidate < 0) || ((a - candidate) > 65535) || (memcmp(in + candidate, in + a, 4) != 0))
+		{	a += (1 + ((a - anchor) >> 6)); //Strides grow through bytes that don't repeat.
+			continue;
+		}
+		
+		long long match_length = 4;
+		while(((a + match_length) < length) && (in[candidate + match_length] == in[a + match_length])) {match_length++;}
+		put = compress_put_sequence(put, in + anchor, a - anchor, a - candidate, match_length);
+		a += match_length;
+		anchor = a;
+	}
+	put = compress_put_sequence(put, in + anchor, length - anchor, 0, 0);
+	return (put - out);
+}
+
+//Gets the file size packed bytes expand to, or -1 if it can't be one.
+long long compress_expanded_length(const unsigned char in[], long long length)
+{	if(length < 5) {return -1;}
+	long long expanded_length = 0;
+	for(int a = 3; a >= 0; a--) {expanded_length = ((expanded_length << 8) | in[a]);}
+	if((expanded_length < 1) || (expanded_length > compress_max_expanded)) {return -1;}
+	return expanded_length;
+}
+
+//Reads a count of 15 or more on from bytes of 255. Returns -1 if the bytes run out.
+long long compress_get_count(const unsigned char** in, const unsigned char* end)
+{	long long count = 15;
+	for(;;)
+	{	if(*in >= end) {return -1;}
+		unsigned char more = *(*in)++;
+		count += more;
+		if(more != 255) {return count;}
+	}
+}
+
+//Expands packed bytes to out[] (compress_expanded_length() bytes.) Returns false unless they make exactly that many, every
+//count and distance within bounds.
+bool compress_expand(const unsigned char in[], long long length, unsigned char out[], long long expanded_length)
+{	const unsigned char* end = (in + length);
+	in += 4;
+	long long done = 0;
+	while(in < end)
+	{	unsigned char token = *in++;
+		long long literal_count = (token >> 4);
+		if(literal_count == 15) {literal_count = compress_get_count(&in, end);}
+		if((literal_count < 0) || (literal_count > (end - in)) || (literal_count > (expanded_length - done))) {return false;}
+		memcpy(out + done, in, literal_count);
+		in   += literal_count;
+		done += literal_count;
+		if(in == end) {break;} //Last sequence.
+		
+		if((end - in) < 2) {return false;}
+		long long distance = (in[0] | (in[1] << 8));
+		in += 2;
+		long long match_length = (token & 15);
+		if(match_length == 15) {match_length = compress_get_count(&in, end);}
+		if(match_length < 0) {return false;}
+		match_length += 4;
+		if((distance < 1) || (distance > done) || (match_length > (expanded_length - done))) {return false;}
+		for(long long a = 0; a < match_length; a++) {out[done + a] = out[done + a - distance];} //Byte by byte: a match may overlap itself.
+		done += match_length;
+	}
+	return (done == expanded_length);
+}
+
+//Expands the stored bytes of a decrypted frame flagged compressed into file. Returns false if they don't expand (see above.)
+bool compress_expand_file(const unsigned char stored[], long long stored_length, vector<unsigned char>& file)
+{	long long expanded_length = compress_expanded_length(stored, stored_length);
+	if(expanded_length == -1) {return false;}
+	file.resize(expanded_length);
+	if(compress_expand(stored, stored_length, file.data(), expanded_length) == true) {return true;}
+	secure_wipe(file.data(), file.size());
+	file.clear();
+	return false;
+}
+
+/*##############################################################################
+Library (g++ -O2 -pthread -DSCHEMEOTP_LIBRARY -c schemeOTP.cpp leaves main() out
+so the object links into another program, which includes schemeOTP.h.) These
+calls do options 1, 2 and 4 on buffers, in a keys folder opened as a store: no
+prompts, no files plainfile or cipherfile. Open the store, reserve a key, then
+encrypt or decrypt with it, then consume it (shredded, counters committed) or
+release it (given back.) Encrypt writes the cipherfile straight into the
+caller's array and decrypt the file straight into the caller's: no staging
+copies. A reserved key is read into a page-aligned 2,000,014-byte buffer from a
+pool that is reused, not allocated per message, and wiped whenever given back.
+Pack slots are used where they lie. Any number of stores (each its own folder,
+with its own keys.reserve mapping) serve any number of threads. Reserving,
+committing and giving back take turns across the process (they work in the
+store's folder), while encrypting, decrypting and shredding don't. Keys are
+made by option 3.
+##############################################################################*/
+const long long buffer_pool_buffer_size = 2002944; //2,000,014 rounded up to whole 4096-byte pages.
+
+struct buffer_pool
+{	mutex                  lock;
+	vector<unsigned char*> free;
+};
+
+buffer_pool key_buffers;
+
+//Takes a buffer from the pool, or allocates one if every buffer is out.
+unsigned char* buffer_pool_take()
+{	{	lock_guard<mutex> hold(key_buffers.lock);
+		if(key_buffers.free.empty() == false) {unsigned char* buffer = key_buffers.free.back(); key_buffers.free.pop_back(); return buffer;}
+	}
+	void* buffer = 0;
+	if(posix_memalign(&buffer, 4096, buffer_pool_buffer_size) != 0) {return 0;}
+	return (unsigned char*)buffer;
+}
+
+//Wipes a buffer, then returns it to the pool.
+void buffer_pool_give(unsigned char* buffer)
+{	if(buffer == 0) {return;}
+	secure_wipe(buffer, buffer_pool_buffer_size);
+	lock_guard<mutex> hold(key_buffers.lock);
+	key_buffers.free.push_back(buffer);
+}
+
+struct otp_store
+{	int               folder;       //The store's folder, open. Calls that touch files work there (see otp_folder.)
+	key_state         state;
+	key_reservations* reservations; //Its keys.reserve, mapped at its first reservation, unmapped by otp_store_close().
+	channel_registry  registry;     //Mapped if opened by peer (otp_store_open_peer()), else header is 0.
+	key_state*        mirror;       //Then the peer's record in it, kept equal to keys.state (see Channel registry.)
+};
+
+struct otp_key
+{	key_slot       key;
+	long long      position;
+	bool           encrypting;
+	unsigned char* buffer;   //From the pool: the key file piece is read here (not used for a pack slot.)
+};
+
+//The current directory, the keys.reserve mapping and key_state_mirror are the process's, so a call that touches files holds
+//otp_folder_lock, moves to its store's folder with the store's mapping and mirror in place, then puts all back. Encrypt and
+//decrypt don't take it.
+mutex otp_folder_lock;
+
+struct otp_folder
+{	otp_store*         store;
+	unique_lock<mutex> hold;
+	int                previous_folder;
+	key_reservations*  previous_reservations;
+	key_state*         previous_mirror;
+	bool               entered; //False if the store's folder could not be entered: touch no file then.
+	
+	otp_folder(otp_store* in_store) : store(in_store), hold(otp_folder_lock)
+	{	previous_folder       = open(".", (O_RDONLY | O_DIRECTORY));
+		previous_reservations = key_reserve_mapping;
+		key_reserve_mapping   = store->reservations;
+		previous_mirror       = key_state_mirror;
+		key_state_mirror      = store->mirror;
+		entered = (fchdir(store->folder) == 0);
+	}
+	
+	~otp_folder()
+	{	store->reservations = key_reserve_mapping;
+		key_reserve_mapping = previous_reservations;
+		key_state_mirror    = previous_mirror;
+		if(previous_folder < 0) {return;}
+		if(fchdir(previous_folder) != 0) {} //Nowhere else to go.
+		close(previous_folder);
+	}
+};
+
+//Closes a store: unmaps its keys.reserve (and channels.registry) and lets go of its folder. Keys still reserved from it stay skipped.
+void otp_store_close(otp_store* store)
+{	if(store == 0) {return;}
+	if(store->reservations != 0) {munmap(store->reservations, 4096);}
+	channel_registry_unmap(store->registry);
+	if(store->folder >= 0) {close(store->folder);}
+	delete store;
+}
+
+otp_store* otp_store_new(const char folder[])
+{	otp_store* store = new otp_store;
+	store->folder          = open(folder, (O_RDONLY | O_DIRECTORY));
+	store->reservations    = 0;
+	store->registry.header = 0;
+	store->mirror          = 0;
+	return store;
+}
+
+//Opens the keys folder at folder (reads keys.state, or rebuilds it.) Returns 0 if there are no keys there.
+otp_store* otp_store_open(const char folder[])
+{	otp_store* store = otp_store_new(folder);
+	bool opened = false;
+	if(store->folder >= 0)
+	{	otp_folder in_folder(store);
+		opened = ((in_folder.entered == true) && (key_state_load(store->state) == true));
+	}
+	if(opened == false) {otp_store_close(store); return 0;}
+	return store;
+}
+
+//Registers peer in channels.registry at folder (made if missing) and makes its folder peers/<ID> there, as --add-peer=ID.
+//Returns false if the ID is not valid or the registry can't take it. (Registered already is fine.)
+bool otp_peer_add(const char folder[], const char peer[])
+{	if(channel_peer_valid(peer) == false) {return false;}
+	otp_store* at = otp_store_new(folder);
+	int registered = -1;
+	if(at->folder >= 0)
+	{	otp_folder in_folder(at);
+		if(in_folder.entered == true) {registered = channel_register(peer);}
+	}
+	otp_store_close(at);
+	return (registered >= 0);
+}
+
+//Opens the keys folder of peer in channels.registry at folder (peers/<ID> there), as --peer=ID: the peer's record is kept
+//equal to its keys.state. Any number of peers may be open at once. Returns 0 if peer is not registered or has no keys.
+otp_store* otp_store_open_peer(const char folder[], const char peer[])
+{	if(channel_peer_valid(peer) == false) {return 0;}
+	otp_store* store = otp_store_new(folder);
+	bool opened = false;
+	if(store->folder >= 0)
+	{	otp_folder in_folder(store);
+		if((in_folder.entered == true) && (channel_registry_map(store->registry, false) == true))
+		{	channel_record* record = channel_find(store->registry, peer);
+			if((record != 0) && (record->peer[0] != 0)) {store->mirror = &record->state;}
+		}
+	}
+	if(store->mirror != 0)
+	{	int peer_folder = openat(store->folder, (string("peers/") + peer).c_str(), (O_RDONLY | O_DIRECTORY));
+		close(store->folder);
+		store->folder = peer_folder;
+	}
+	if((store->mirror != 0) && (store->folder >= 0))
+	{	otp_folder in_folder(store);
+		opened = ((in_folder.entered == true) && (key_state_load(store->state) == true));
+		if(opened == true) {*store->mirror = store->state;} //Keys copied in, or used without the registry.
+	}
+	if(opened == false) {otp_store_close(store); return 0;}
+	return store;
+}
+
+//Gets the files left to encrypt (or decrypt) with this store.
+int otp_files_left(otp_store* store, bool encrypting)
+{	lock_guard<mutex> hold(otp_folder_lock);
+	return key_state_files_left(store->state, encrypting);
+}
+
+//Gets the bytes of every cipherfile (7 + size class), and the most a file may have (the size class, unless compressed.)
+long long otp_cipherfile_length(const otp_store* store) {return (store->state.class_size + 7);}
+long long otp_file_length_max  (const otp_store* store) {return  store->state.class_size     ;}
+
+//Reserves the next key (or piece) to encrypt or decrypt with, and loads it. No other process or thread gets it.
+//Returns 0 if none is left or it can't be read.
+otp_key* otp_reserve(otp_store* store, bool encrypting)
+{	long long class_size = store->state.class_size;
+	int pieces = size_class_pieces(class_size);
+	otp_key* key = new otp_key;
+	key->encrypting = encrypting;
+	key->position   = -1;
+	key->buffer     = buffer_pool_take();
+	otp_folder in_folder(store);
+	if((in_folder.entered == true) && (key->buffer != 0)) {key->position = key_reserve(store->state, encrypting);}
+	if(key->position != -1)
+	{	key_slot_set(key->key, key_state_outgoing(store->state, encrypting), (key->position / pieces), (key->position % pieces), class_size);
+		if(key_load(key->key, key->buffer) == true) {return key;}
+		key_release(key->key);
+		key_unreserve(store->state, encrypting, key->position, key->position + 1);
+	}
+	buffer_pool_give(key->buffer);
+	delete key;
+	return 0;
+}
+
+//Gets the key's place in its folder (key number * pieces per key + piece.) The other side reserves keys in the same order, so
+//label each cipherfile with it when several are encrypted at once.
+long long otp_key_position(const otp_key* key) {return key->position;}
+
+//Encrypts length bytes of file[] with a key reserved for encrypting, to cipherfile[] (otp_cipherfile_length() bytes.) Compress:
+//packs the file first, kept if smaller (see Compression), so it may then be up to compress_max_expanded bytes. Returns the
+//cipherfile length, or -1 if the file doesn't fit.
+long long otp_encrypt_buffer(const otp_store* store, const otp_key* key, const unsigned char file[], long long length, unsigned char cipherfile[], bool compress)
+{	long long class_size = store->state.class_size;
+	if((key->encrypting == false) || (length < 1)) {return -1;}
+	
+	vector<unsigned char> compressed_file;
+	bool compressed = false;
+	if((compress == true) && (length <= compress_max_expanded))
+	{	compressed_file.resize(compress_bound(length));
+		long long compressed_size = compress_bytes(file, length, compressed_file.data());
+		if(compressed_size < length) {file = compressed_file.data(); length = compressed_size; compressed = true;}
+	}
+	if(length > class_size) {secure_wipe(compressed_file.data(), compressed_file.size()); return -1;}
+	
+	memcpy(cipherfile + 7, file, length);
+	secure_wipe(compressed_file.data(), compressed_file.size());
+	frame_encrypt(cipherfile, key->key.bytes, length, class_size, compressed);
+	return (class_size + 7);
+}
+
+//Decrypts cipherfile[] (length must be otp_cipherfile_length()) with a key reserved for decrypting, to file[] (capacity bytes:
+//the size class is enough, unless the file was compressed.) Only the file's own bytes are decrypted. Returns the file length,
+//or -1 if it's not a cipherfile or file[] is too small.
+long long otp_decrypt_buffer(const otp_store* store, const otp_key* key, const unsigned char cipherfile[], long long length, unsigned char file[], long long capacity)
+{	long long class_size = store->state.class_size;
+	if((key->encrypting == true) || (length != (class_size + 7))) {return -1;}
+	const unsigned char* sub_key = (key->key.bytes + class_size + 7);
+	
+	unsigned char header[7];
+	cipher_subtract_bytes(header, cipherfile, sub_key, 7);
+	bool compressed;
+	long long extracted_file_size = frame_file_size(header, class_size, &compressed);
+	if(compressed == true) //Decrypted to the pooled buffer (the key is read already), then expanded to file[].
+	{	unsigned char* stored = buffer_pool_take();
+		if(stored == 0) {return -1;}
+		cipher_subtract_bytes(stored, cipherfile + 7, sub_key + 7, extracted_file_size);
+		long long expanded_length = compress_expanded_length(stored, extracted_file_size);
+		bool expanded = ((expanded_length != -1) && (expanded_length <= capacity) && (compress_expand(stored, extracted_file_size, file, expanded_length) == true));
+		if((expanded == false) && (extracted_file_size <= capacity)) {memcpy(file, stored, extracted_file_size);} //As it is (see Compression.)
+		buffer_pool_give(stored);
+		if(expanded == true) {return expanded_length;}
+		if(extracted_file_size > capacity) {return -1;}
+		return extracted_file_size;
+	}
+	
+	if(extracted_file_size > capacity) {return -1;}
+	cipher_subtract_bytes(file, cipherfile + 7, sub_key + 7, extracted_file_size);
+	return extracted_file_size;
+}
+
+//Shreds a used key (or wipes its piece), commits it to keys.state and frees key. Returns false if shredding or the commit
+//failed (the key is used anyway.) The shred itself runs outside otp_folder_lock: other threads and stores go on meanwhile.
+bool otp_consume(otp_store* store, otp_key* key)
+{	bool last_piece = (key->key.piece == (size_class_pieces(store->state.class_size) - 1));
+	shred_report report;
+	report.failed = true;
+	thread shredder;
+	bool entered;
+	{	otp_folder in_folder(store); //Key file renamed (or opened) here, in the store's folder.
+		entered = in_folder.entered;
+		if     (entered    == false) {key_release(key->key);}
+		else if(last_piece == true ) {shredder = key_consume_async      (key->key, &report);}
+		else                         {shredder = key_consume_piece_async(key->key, &report);}
+	}
+	if(shredder.joinable() == true) {shredder.join();}
+	buffer_pool_give(key->buffer);
+	if(entered == true)
+	{	otp_folder in_folder(store);
+		if(in_folder.entered == false) {report.failed = true;}
+		else if(key_state_commit(store->state, key->encrypting, key->position + 1, (last_piece == true) ? 1 : 0, false) == false) {report.failed = true;}
+	}
+	delete key;
+	return (report.failed == false);
+}
+
+//Gives back a reserved key that was not used, and frees key. Returns false if another process reserved past it meanwhile
+//(it is then skipped.)
+bool otp_release(otp_store* store, otp_key* key)
+{	key_release(key->key);
+	buffer_pool_give(key->buffer);
+	bool given_back = false;
+	{	otp_folder in_folder(store);
+		if(in_folder.entered == true) {given_back = key_unreserve(store->state, key->encrypting, key->position, key->position + 1);}
+	}
+	delete key;
+	return given_back;
+}
+
+//Swaps channels on this end (option 4): creates file swapped if absent, removes it otherwise, and toggles symmetry.entanglement.
+//Returns true if channels are now swapped. The other end must do the same.
+bool swap_channels_here()
+{	bool swapped = (file_exists("swapped") == false);
+	ofstream out_stream;
+	
+	//Creates file swapped if non-existent, removes it otherwise. This is pure SYMMETRY rather than entanglement.
+	if(swapped == true)
+	{	out_stream.open("swapped");
+		out_stream << 1;
+		out_stream.close();
+	}
+	else {remove("swapped");}
+	
+	//Creates file symmetry.entanglement if non-existent, removes it otherwise. This is pure ENTANGLEMENT rather than symmetry.
+	if(file_exists("symmetry.entanglement") == false)
+	{	out_stream.open("symmetry.entanglement");
+		out_stream << "REMINDER: one of you must remove this file!\n"
+		           << "(Key maker had already been asked to do so.)";
+		out_stream.close();
+	}
+	else {remove("symmetry.entanglement");}
+	
+	//Records both in keys.state (under keys.lock, as another process may be committing keys.)
+	key_state state;
+	if(key_state_load(state) == true)
+	{	chrono::steady_clock::time_point phase_start = stats_begin();
+		int lock = key_state_lock();
+		key_state_read(state);
+		state.swapped      = file_exists("swapped"              );
+		state.entanglement = file_exists("symmetry.entanglement");
+		key_state_save(state);
+		key_state_unlock(lock);
+		stats_end("counter_commit", phase_start, 0);
+	}
+	return swapped;
+}
+
+//Swaps channels on this end of store (as option 4, see swap_channels_here().) Returns true if channels are now swapped.
+bool otp_swap_channels(otp_store* store)
+{	otp_folder in_folder(store);
+	if(in_folder.entered == false) {return false;}
+	bool swapped = swap_channels_here();
+	key_state_load(store->state);
+	return swapped;
+}
+
+/*##############################################################################
+Keygen version 3 - counter-based and multi-threaded. Version 2.2 feeds each seed
+to srand() and walks the whole table once per seed, so every byte waits for all
+bytes before it. Here each of the same 92 passes (90 seeds, sum of all seeds and
+sum of every other seed) is a SplitMix64 stream: word w of a pass is a function
+of only that pass's key and w. Any chunk of the table can therefore be built on
+its own, by any thread, in any order--output depends on seeds alone, not on the
+thread count. Passes of odd seeds still run their counter right to left.
+##############################################################################*/
+const long long keygen_table_size    = 501000000; //250 keys of 2,000,014 char, plus reserve (same as v2.2.)
+const long long keygen_v3_chunk_size =   1048576; //Bytes per work item handed to a thread (multiple of 8.)
+const int       keygen_passes        =        92; //90 user seeds + sum of all seeds + sum of every other seed.
+
+unsigned long long keygen_v3_mix(unsigned long long z) //SplitMix64 finalizer.
+{	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+unsigned long long keygen_v3_add_bytes(unsigned long long x, unsigned long long y) //Adds 8 bytes at once, each mod 256.
+{	unsigned long long low_seven_bits = ((x & 0x7F7F7F7F7F7F7F7FULL) + (y & 0x7F7F7F7F7F7F7F7FULL));
+	return low_seven_bits ^ ((x ^ y) & 0x8080808080808080ULL);
+}
+
+//Gets the 92 pass seeds in v2.2 order: each user seed, then sum of all, then sum of every other (both mod 10^9.)
+void keygen_pass_seeds(const unsigned int user_seeds[90], unsigned int pass_seeds[keygen_passes])
+{	unsigned int seeds_sum = 0;
+	for(int a = 0; a < 90; a++) {pass_seeds[a] = user_seeds[a]; seeds_sum += user_seeds[a]; seeds_sum %= 1000000000;}
+	pass_seeds[90] = seeds_sum;
+	seeds_sum = 0;
+	for(int a = 0; a < 90; a += 2) {seeds_sum += user_seeds[a]; seeds_sum %= 1000000000;}
+	pass_seeds[91] = seeds_sum;
+}
+
+//Fills window[] (table bytes window_start onward) with chunks taken from a shared counter until none are left.
+//One of these runs per thread. Chunks are whole table words, trimmed where the window edges cut through one.
+void keygen_v3_worker(unsigned char window[], long long window_start, long long window_length, const unsigned long long pass_keys[keygen_passes], const bool pass_right_to_left[keygen_passes], atomic<long long>* next_chunk)
+{	const long long words_in_table = (keygen_table_size / 8);
+	const long long window_end     = (window_start + window_length);
+	for(;;)
+	{	long long chunk_start = (((window_start / 8) * 8) + next_chunk->fetch_add(keygen_v3_chunk_size));
+		if(chunk_start >= window_end) {return;}
+		long long chunk_end = chunk_start + keygen_v3_chunk_size;
+		if(chunk_end > window_end) {chunk_end = window_end;}
+		
+		for(long long w = (chunk_start / 8); (w * 8) < chunk_end; w++)
+		{	unsigned long long sum = 0;
+			for(int p = 0; p < keygen_passes; p++)
+			{	unsigned long long counter = w;
+				if(pass_right_to_left[p] == true) {counter = (words_in_table - 1 - w);}
+				sum = keygen_v3_add_bytes(sum, keygen_v3_mix(pass_keys[p] + ((counter + 1) * 0x9E3779B97F4A7C15ULL)));
+			}
+			
+			for(int b = 0; b < 8; b++) //Byte order fixed here, not by the machine.
+			{	long long position = ((w * 8) + b);
+				if((position >= window_start) && (position < window_end)) {window[position - window_start] = (sum >> (b * 8));}
+			}
+		}
+	}
+}
+
+//Runs keygen version 3 over table bytes window_start to window_start + window_length - 1 using the given number of threads.
+void keygen_v3_fill(unsigned char window[], long long window_start, long long window_length, const unsigned int user_seeds[90], int thread_count)
+{	unsigned int pass_seeds[keygen_passes];
+	unsigned long long pass_keys[keygen_passes];
+	bool pass_right_to_left[keygen_passes];
+	keygen_pass_seeds(user_seeds, pass_seeds);
+	for(int p = 0; p < keygen_passes; p++)
+	{	pass_keys[p] = keygen_v3_mix(pass_seeds[p] + ((unsigned long long)(p + 1) << 32)); //Pass number included so equal seeds still differ.
+		pass_right_to_left[p] = ((pass_seeds[p] % 2) == 1);
+		if(p == 90) {pass_right_to_left[p] = false;} //v2.2 runs the sum of all seeds left to right regardless,
+		if(p == 91) {pass_right_to_left[p] =  true;} //and the sum of every other seed right to left regardless.
+	}
+	
+	atomic<long long> next_chunk(0);
+	vector<thread> threads;
+	for(int t = 1; t < thread_count; t++) {threads.push_back(thread(keygen_v3_worker, window, window_start, window_length, pass_keys, pass_right_to_left, &next_chunk));}
+	keygen_v3_worker(window, window_start, window_length, pass_keys, pass_right_to_left, &next_chunk);
+	for(unsigned int t = 0; t < threads.size(); t++) {threads[t].join();}
+	
+	secure_wipe(pass_seeds, sizeof(pass_seeds));
+	secure_wipe(pass_keys , sizeof(pass_keys ));
+}
+
+//Keygen v2.2 exactly as it always ran--one srand() and one pass of rand() per seed. Reference for the parallel engine below.
+void keygen_v2_serial(unsigned char table[], int table_size, const unsigned int user_seeds[90], bool show_progress)
+{	int temp_modular_arithmetic;
+	for(int a = 0; a < 90; a++) //Constructively applies random digits to table[] based on the 90 seeds provided by the user.
+	{	if(show_progress == true) {cout << "\rPass " << (a + 1) << " of 92..." << flush;}
+		srand(user_seeds[a]);   //WRITES ALTERNATING BETWEEN LEFT TO RIGHT & RIGHT TO LEFT. Alternation is based on the 90 user seeds.
+		
+		if((user_seeds[a] % 2) == 0)
+		{	for(int b = 0; b < table_size; b++) //WRITES LEFT TO RIGHT.
+			{	temp_modular_arithmetic = table[b];
+				temp_modular_arithmetic += (rand() % 256);
+				temp_modular_arithmetic %= 256;
+				table[b] = temp_modular_arithmetic;
+			}
+		}
+		else
+		{	for(int b = (table_size - 1); b >= 0; b--) //WRITES RIGHT TO LEFT.
+			{	temp_modular_arithmetic = table[b];
+				temp_modular_arithmetic += (rand() % 256);
+				temp_modular_arithmetic %= 256;
+				table[b] = temp_modular_arithmetic;
+			}
+		}
+	}
+	
+	//Adding additional randomness in table[].
+	unsigned int seeds_sum = 0;
+	for(int a = 0; a < 90; a++)
+	{	seeds_sum += user_seeds[a];
+		seeds_sum %= 1000000000;
+	}
+	if(show_progress == true) {cout << "\rPass 91 of 92..." << flush;}
+	srand(seeds_sum); //A new 9-digit seed comes from the sum of ALL user-seeds.
+	for(int a = 0; a < table_size; a++) //WRITES LEFT TO RIGHT.
+	{	temp_modular_arithmetic = table[a];
+		temp_modular_arithmetic += (rand() % 256);
+		temp_modular_arithmetic %= 256;
+		table[a] = temp_modular_arithmetic;
+	}
+	
+	//Again, adding additional randomness in table[].
+	seeds_sum = 0;
+	for(int a = 0; a < 90; a += 2)
+	{	seeds_sum += user_seeds[a];
+		seeds_sum %= 1000000000;
+	}
+	if(show_progress == true) {cout << "\rPass 92 of 92...\n" << flush;}
+	srand(seeds_sum); //Another new 9-digit seed comes from the sum of EVERY OTHER user-seed.
+	for(int a = (table_size - 1); a >= 0; a--) //WRITES RIGHT TO LEFT.
+	{	temp_modular_arithmetic = table[a];
+		temp_modular_arithmetic += (rand() % 256);
+		temp_modular_arithmetic %= 256;
+		table[a] = temp_modular_arithmetic;
+	}
+}
+
+/*##############################################################################
+Keygen v2.2, parallel and bit-exact. glibc's rand() (TYPE_3) is an additive lag
+Fibonacci generator: r[i] = r[i - 3] + r[i - 31] (mod 2^32), and the k-th output
+is r[k + 344] >> 1. srand(seed) fills r[0 - 30] by  16807 * r[i - 1] mod 2^31-1
+and copies r[31 - 33] from r[0 - 2]. The recurrence is linear, so x^n mod  (x^31
+- x^28 - 1) gives the 31 weights that turn any 31 consecutive values into those
+n places later. Each thread then jumps straight to its own slice of every pass.
+Sums mod 256 do not care about pass order, so the slices never wait on another.
+##############################################################################*/
+const int legacy_rand_lag = 31;
+
+//Gets s[0 - 61] = r[3 - 64] for srand(seed). From s[31] onward: s[m] = s[m - 3] + s[m - 31].
+void legacy_rand_base(unsigned int seed, unsigned int s[62])
+{	unsigned int r[65];
+	int word = seed;
+	if(word == 0) {word = 1;}
+	r[0] = word;
+	for(int i = 1; i < 31; i++)
+	{	long long high = word / 127773;
+		long long low  = word % 127773;
+		long long next = (16807 * low) - (2836 * high);
+		if(next < 0) {next += 2147483647;}
+		word = next;
+		r[i] = word;
+	}
+	for(int i = 31; i < 34; i++) {r[i] = r[i - 31];}
+	for(int i = 34; i < 65; i++) {r[i] = r[i - 31] + r[i - 3];}
+	for(int i =  0; i < 62; i++) {s[i] = r[i + 3];}
+	secure_wipe(r, sizeof(r));
+}
+
+//Multiplies two polynomials of degree < 31 modulo x^31 - x^28 - 1. Coefficients wrap mod 2^32 as the generator does.
+void legacy_rand_polynomial_multiply(const unsigned int x[legacy_rand_lag], const unsigned int y[legacy_rand_lag], unsigned int product[legacy_rand_lag])
+{	unsigned int full[(legacy_rand_lag * 2) - 1] = {0};
+	for(int a = 0; a < legacy_rand_lag; a++)
+	{	if(x[a] == 0) {continue;}
+		for(int b = 0; b < legacy_rand_lag; b++) {full[a + b] += (x[a] * y[b]);}
+	}
+	for(int d = ((legacy_rand_lag * 2) - 2); d >= legacy_rand_lag; d--) //x^31 = x^28 + 1.
+	{	full[d - 3 ] += full[d];
+		full[d - 31] += full[d];
+	}
+	for(int a = 0; a < legacy_rand_lag; a++) {product[a] = full[a];}
+}
+
+//Fills ring[] with s[n] to s[n + 30] given the base from legacy_rand_base(). Costs 30 polynomial products at most.
+void legacy_rand_jump(const unsigned int base[62], long long n, unsigned int ring[legacy_rand_lag])
+{	unsigned int weights[legacy_rand_lag] = {0};
+	unsigned int power  [legacy_rand_lag] = {0};
+	unsigned int temp   [legacy_rand_lag];
+	weights[0] = 1; //x^0
+	power  [1] = 1; //x^1, squared each round to x^2, x^4, x^8...
+	for(; n > 0; n >>= 1)
+	{	if((n & 1) == 1)
+		{	legacy_rand_polynomial_multiply(weights, power, temp);
+			for(int a = 0; a < legacy_rand_lag; a++) {weights[a] = temp[a];}
+		}
+		legacy_rand_polynomial_multiply(power, power, temp);
+		for(int a = 0; a < legacy_rand_lag; a++) {power[a] = temp[a];}
+	}
+	for(int j = 0; j < legacy_rand_lag; j++)
+	{	unsigned int value = 0;
+		for(int k = 0; k < legacy_rand_lag; k++) {value += (weights[k] * base[k + j]);}
+		ring[j] = value;
+	}
+}
+
+//Adds outputs k_start to k_end - 1 of one srand(seed) stream into the table (mod 256), with output k landing
+//on table byte k when left to right, or on table byte table_size - 1 - k when right to left. window[] holds the
+//table from byte window_start onward.
+void legacy_rand_add_slice(unsigned char window[], long long window_start, long long table_size, unsigned int seed, bool right_to_left, long long k_start, long long k_end)
+{	unsigned int base[62];
+	unsigned int ring[legacy_rand_lag];
+	legacy_rand_base(seed, base);
+	legacy_rand_jump(base, (k_start + 341), ring); //Output k is s[k + 341].
+	int position = 0;
+	unsigned char random_bytes[4096]; //Made one block at a time, then added into the window by cipher_add_bytes().
+	for(long long block_start = k_start; block_start < k_end; block_start += 4096)
+	{	int block_length = 4096;
+		if((block_start + block_length) > k_end) {block_length = (k_end - block_start);}
+		
+		for(int j = 0; j < block_length; j++)
+		{	unsigned int value = ring[position];
+			int lag_3 = position + 28; if(lag_3 >= legacy_rand_lag) {lag_3 -= legacy_rand_lag;}
+			ring[position] = value + ring[lag_3]; //s[m + 31] = s[m] + s[m + 28].
+			position++; if(position == legacy_rand_lag) {position = 0;}
+			
+			if(right_to_left == false) {random_bytes[                   j] = ((value >> 1) % 256);}
+			else                       {random_bytes[block_length - 1 - j] = ((value >> 1) % 256);} //Reversed, lands right to left.
+		}
+		
+		unsigned char* destination;
+		if(right_to_left == false) {destination = (window + (block_start                                   - window_start));}
+		else                       {destination = (window + (table_size - block_start - block_length - window_start));}
+		cipher_add_bytes(destination, destination, random_bytes, block_length);
+	}
+	secure_wipe(random_bytes, sizeof(random_bytes));
+	secure_wipe(ring        , sizeof(ring        ));
+	secure_wipe(base        , sizeof(base        ));
+}
+
+//All 92 passes over table bytes first to last - 1, in v2.2 order and direction.
+void keygen_v2_parallel_worker(unsigned char window[], long long window_start, long long table_size, const unsigned int pass_seeds[keygen_passes], long long first, long long last)
+{	for(int p = 0; p < keygen_passes; p++)
+	{	bool right_to_left = ((pass_seeds[p] % 2) == 1);
+		if(p == 90) {right_to_left = false;}
+		if(p == 91) {right_to_left =  true;}
+		
+		if(right_to_left == false) {legacy_rand_add_slice(window, window_start, table_size, pass_seeds[p], false,                first,                 last);}
+		else                       {legacy_rand_add_slice(window, window_start, table_size, pass_seeds[p],  true, (table_size - last), (table_size - first));}
+	}
+}
+
+//Same output as keygen_v2_serial() for table bytes window_start to window_start + window_length - 1 (zeroed
+//window[] expected), split into one contiguous slice per thread. The whole table never has to exist at once.
+void keygen_v2_parallel(unsigned char window[], long long window_start, long long window_length, long long table_size, const unsigned int user_seeds[90], int thread_count)
+{	unsigned int pass_seeds[keygen_passes];
+	keygen_pass_seeds(user_seeds, pass_seeds);
+	
+	vector<thread> threads;
+	for(int t = 0; t < thread_count; t++)
+	{	long long first = (window_start + ((window_length *  t     ) / thread_count));
+		long long last  = (window_start + ((window_length * (t + 1)) / thread_count));
+		if(t == (thread_count - 1)) {keygen_v2_parallel_worker(window, window_start, table_size, pass_seeds, first, last);}
+		else {threads.push_back(thread(keygen_v2_parallel_worker, window, window_start, table_size, pass_seeds, first, last));}
+	}
+	for(unsigned int t = 0; t < threads.size(); t++) {threads[t].join();}
+	
+	secure_wipe(pass_seeds, sizeof(pass_seeds));
+}
+
+//Runs both engines on a small table with the user's seeds and compares. A C library whose rand() is not glibc's
+//fails here, and option 3 falls back to the serial engine. (tests/keygen_v2_parallel.cpp checks many sizes and threads.)
+bool keygen_v2_parallel_matches_serial(const unsigned int user_seeds[90])
+{	const int check_size = 100003; //Odd size and 3 threads so that slice edges fall mid-word and mid-pass.
+	vector<unsigned char> serial  (check_size, 0);
+	vector<unsigned char> parallel(check_size, 0);
+	keygen_v2_serial  (serial.data()  , check_size, user_seeds, false);
+	keygen_v2_parallel(parallel.data()        ,     0,             40000, check_size, user_seeds, 3); //Two windows, as streamed.
+	keygen_v2_parallel(parallel.data() + 40000, 40000, check_size - 40000, check_size, user_seeds, 3);
+	bool matches = (serial == parallel);
+	secure_wipe(serial.data()  , check_size);
+	secure_wipe(parallel.data(), check_size);
+	return matches;
+}
+
+/*##############################################################################
+Health tests. Option 3 checks each key before writing it, on the writer thread
+while the next window is made, so they cost next to nothing: a byte histogram
+against the uniform one (chi-square, 255 degrees of freedom), the repetition
+count and adaptive proportion tests of NIST SP 800-90B (a byte repeated too many
+times in a row, or too often within 512 bytes), and the serial correlation of
+neighbouring bytes. The histogram keeps 4 tables filled in turn, so consecutive
+bytes never wait on the same counter, and the sums for the correlation are kept
+alongside it. Each limit is set so that a good key of 2,000,014 bytes trips
+that test with probability at most alpha = 2^-40 (about 9 x 10^-13), counting
+every place in the key a test looks (each of 2 million runs, each of 3906
+windows), not just one. With 4 tests on 250 keys, a good seed set is refused
+about once in 3 billion. If one trips, no more keys are written, no counters or
+keys.state are made (so the folder can't be used), keygen.health tells which key
+failed which test and by how much, and the checkpoint goes: run option 3 again
+with other seeds. Peers who must make the same keys from the same seeds (v2.2
+regeneration) run schemeOTP --health=warn instead: every key is still tested and
+keygen.health lists how many failed, but all are written and the folder is made.
+##############################################################################*/
+const double health_chi_square_limit   =  450.0; //255 degrees of freedom: 5.8 x 10^-13 past this for uniform bytes.
+const int    health_repetition_limit   =      9; //Same byte this many times in a row: 256^-8 per place, 1.1 x 10^-13 per key.
+const int    health_proportion_window  =    512;
+const int    health_proportion_limit   =     24; //First byte of a window seen this often within it: 1.2 x 10^-13 per key.
+const double health_correlation_limit  =    7.2; //Serial correlation past this many standard deviations (1 / sqrt(n) each): 6.0 x 10^-13.
+bool health_warn_only = false; //--health=warn: report keys that fail, but keep them.
+
+struct keygen_health
+{	bool        failed;      //A key failed and keygen stops (never with health_warn_only.)
+	int         keys_failed; //Of those tested so far.
+	int         key_number;  //0 - 249, of the first key that failed.
+	const char* test;
+	double      statistic;
+	double      limit;
+};
+
+//Runs all four tests on length bytes of key[]. Returns false if one trips, and fills health if it is the first key to fail.
+bool health_test_key(const unsigned char key[], long long length, int key_number, keygen_health& health)
+{	//Histogram in 4 tables, plus sums for the serial correlation.
+	unsigned int counts[4][256] = {{0}};
+	unsigned long long sum = 0, sum_of_squares = 0, sum_of_products = 0;
+	long long a = 0;
+	for(; (a + 4) <= length; a += 4)
+	{	unsigned int x0 = key[a], x1 = key[a + 1], x2 = key[a + 2], x3 = key[a + 3];
+		counts[0][x0]++; counts[1][x1]++; counts[2][x2]++; counts[3][x3]++;
+		sum             += (x0 + x1 + x2 + x3);
+		sum_of_squares  += ((x0 * x0) + (x1 * x1) + (x2 * x2) + (x3 * x3));
+		sum_of_products += ((x0 * x1) + (x1 * x2) + (x2 * x3) + (x3 * key[(a + 4) % length])); //Circular, as Knuth's test.
+	}
+	for(; a < length; a++)
+	{	unsigned int x = key[a];
+		counts[0][x]++;
+		sum             += x;
+		sum_of_squares  += (x * x);
+		sum_of_products += (x * key[(a + 1) % length]);
+	}
+	
+	double expected = (length / 256.0), chi_square = 0;
+	for(int b = 0; b < 256; b++)
+	{	double difference = ((counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b]) - expected);
+		chi_square += ((difference * difference) / expected);
+	}
+	double n = length;
+	double correlation = (((n * sum_of_products) - ((double)sum * sum)) / ((n * sum_of_squares) - ((double)sum * sum)));
+	double correlation_deviations = (correlation * sqrt(n));
+	
+	//Repetition count and adaptive proportion.
+	int longest_run = 1, run = 1, most_in_window = 0;
+	for(long long b = 1; b < length; b++)
+	{	if(key[b] == key[b - 1]) {run++; if(run > longest_run) {longest_run = run;}}
+		else                     {run = 1;}
+	}
+	for(long long window = 0; (window + health_proportion_window) <= length; window += health_proportion_window)
+	{	int seen = 0;
+		unsigned char first = key[window];
+		for(int b = 0; b < health_proportion_window; b++) {seen += (key[window + b] == first);}
+		if(seen > most_in_window) {most_in_window = seen;}
+	}
+	
+	const char* test;
+	double statistic, limit;
+	if(chi_square >= health_chi_square_limit)                  {test = "chi-square of the byte histogram"; statistic = chi_square;  limit = health_chi_square_limit;}
+	else if(longest_run >= health_repetition_limit)            {test = "repetition count"                ; statistic = longest_run; limit = health_repetition_limit;}
+	else if(most_in_window >= health_proportion_limit)         {test = "adaptive proportion"             ; statistic = most_in_window; limit = health_proportion_limit;}
+	else if(fabs(correlation_deviations) >= health_correlation_limit) {test = "serial correlation (deviations)"; statistic = correlation_deviations; limit = health_correlation_limit;}
+	else {return true;}
+	if(health.keys_failed == 0)
+	{	health.key_number = key_number;
+		health.test       = test;
+		health.statistic  = statistic;
+		health.limit      = limit;
+	}
+	health.keys_failed++;
+	health.failed = (health_warn_only == false);
+	return false;
+}
+
+//Tells which key failed which test, on screen and in keygen.health.
+void health_report(const keygen_health& health)
+{	bool outgoing = (health.key_number >= 125);
+	char file_name[20];
+	key_file_name(file_name, outgoing, health.key_number % 125);
+	string report = "Key " + string(file_name + 2) + " failed the " + health.test + " health test: " + to_string(health.statistic)
+	              + " against a limit of " + to_string(health.limit) + ".\n";
+	if(health.failed == true) {report += "No counters or keys.state were made, so these keys can't be used. Run option 3 again with other seeds.\n";}
+	else {report += to_string(health.keys_failed) + " of 250 keys failed a health test. All were kept (--health=warn.)\n";}
+	cout << "\n\n" << report;
+	ofstream out_stream;
+	out_stream.open("keygen.health");
+	out_stream << report;
+	out_stream.close();
+}
+
+/*##############################################################################
+Streaming keygen. Keys are cut from the table in order: table bytes 0 - 2000013
+are incoming/000, the next 2,000,014 are incoming/001, and so on to outgoing/124.
+Both parallel engines can build any stretch of the table without the rest, so a
+window of whole keys is generated, handed to a writer thread, and the next window
+is generated in a second buffer meanwhile. RAM stays near keygen_memory_cap.
+Checkpoints: once a window's keys are written and synced, keygen.checkpoint says
+how many keys are done, with the choices and seeds of the run. If option 3 stops
+(killed, power cut), running it again offers to go on from there, without seeds
+typed again. The file holds the seeds: it's overwritten in place, never copied,
+and shredded once all keys are made. (The v2.2 serial engine builds all keys at
+once, so it resumes from its first pass, still without the seeds typed again.)
+##############################################################################*/
+const long long keygen_memory_cap = 33554432; //Bytes of keys held in RAM by option 3 (both windows.) Raise for fewer, larger windows.
+
+struct keygen_checkpoint
+{	char         magic[8];          //"OTPkgck1"
+	int          keygen_version;    //2 or 3, as chosen in option 3...
+	int          engine;            //...and the engine it runs (see keygen_stream_keys().)
+	int          packed;
+	int          size_class_option;
+	unsigned int user_seeds[90];
+	int          keys_done;         //Keys written and synced, in table order.
+	unsigned int checksum;          //FNV-1a of all the above.
+};
+
+unsigned int keygen_checkpoint_checksum(const keygen_checkpoint& checkpoint)
+{	const unsigned char* bytes = (const unsigned char*)&checkpoint;
+	unsigned int hash = 2166136261u;
+	for(unsigned int a = 0; a < offsetof(keygen_checkpoint, checksum); a++) {hash = ((hash ^ bytes[a]) * 16777619u);}
+	return hash;
+}
+
+//Writes keygen.checkpoint over itself (one file, so no stale copy of the seeds is left behind) and syncs it.
+bool keygen_checkpoint_save(keygen_checkpoint& checkpoint)
+{	memcpy(checkpoint.magic, "OTPkgck1", 8);
+	checkpoint.checksum = keygen_checkpoint_checksum(checkpoint);
+	int file_descriptor = open("keygen.checkpoint", (O_WRONLY | O_CREAT), 0600);
+	if(file_descriptor < 0) {return false;}
+	bool written = (pwrite(file_descriptor, &checkpoint, sizeof(checkpoint), 0) == (ssize_t)sizeof(checkpoint));
+	if(fdatasync(file_descriptor) != 0) {written = false;}
+	close(file_descriptor);
+	return written;
+}
+
+//Gets the checkpoint of an interrupted option 3. Returns false if there is none (or it's damaged.)
+bool keygen_checkpoint_read(keygen_checkpoint& checkpoint)
+{	long long length = block_read_file("keygen.checkpoint", (unsigned char*)&checkpoint, sizeof(checkpoint));
+	if(length != (long long)sizeof(checkpoint)) {return false;}
+	return ((memcmp(checkpoint.magic, "OTPkgck1", 8) == 0) && (checkpoint.checksum == keygen_checkpoint_checksum(checkpoint))
+	     && (checkpoint.keys_done >= 0) && (checkpoint.keys_done <= 250));
+}
+
+//Shreds keygen.checkpoint (it holds the seeds.)
+void keygen_checkpoint_remove()
+{	shred_report report;
+	if(file_exists("keygen.checkpoint") == true) {shred_file("keygen.checkpoint", &report);}
+}
+
+//Makes sure the keys written so far are on disk before the checkpoint says so. Returns false if they may not be.
+bool keygen_sync_keys()
+{	int file_descriptor = open("keys", O_RDONLY);
+	if(file_descriptor < 0) {return false;}
+	bool synced = (syncfs(file_descriptor) == 0);
+	close(file_descriptor);
+	return synced;
+}
+
+//Writes key_number (0 - 124 incoming, 125 - 249 outgoing) to its file, or to its slot in a pack. Returns false if it fails.
+bool keygen_write_key(const unsigned char key[], int key_number, bool packed)
+{	bool outgoing = (key_number >= 125);
+	if(outgoing == true) {key_number -= 125;}
+	if(packed == true) {return key_pack_write_slot(outgoing, key_number, key);}
+	
+	char file_name_key[20];
+	key_file_name(file_name_key, outgoing, key_number);
+	return block_write_file(file_name_key, key, 2000014);
+}
+
+//Tests each key before writing it, and stops at the first that fails (health tells which) unless health_warn_only.
+//Also stops at the first key that can't be written, setting write_failed.
+void keygen_write_window(const unsigned char window[], int first_key, int key_count, bool packed, keygen_health* health, bool* write_failed)
+{	for(int i = 0; i < key_count; i++)
+	{	const unsigned char* key = (window + (i * 2000014LL));
+		if((health_test_key(key, 2000014, (first_key + i), *health) == false) && (health->failed == true)) {return;}
+		if(keygen_write_key(key, (first_key + i), packed) == false) {*write_failed = true; return;}
+	}
+}
+
+//Prints keys made so far of 250, the rate since start (keys_at_start made before it) and the time left, over the last such line.
+void keygen_print_progress(int keys_made, int keys_at_start, chrono::steady_clock::time_point start)
+{	int    keys_to_make = 250;
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	double rate    = ((seconds > 0) ? (((keys_made - keys_at_start) * 2000014.0) / seconds) : 0);
+	cout << "\rKeys " << keys_made << " of " << keys_to_make << ", " << ((int)(rate / 100000) / 10.0) << " MB/s";
+	if(rate > 0) {cout << ", about " << (int)(((keys_to_make - keys_made) * 2000014.0) / rate) << "s left.   ";}
+	cout << flush;
+}
+
+//Engine 3 = keygen v3, engine 2 = v2.2 jump-ahead, engine 0 = v2.2 serial (the only one needing the whole table.)
+//Packed = write keys/incoming.pack and keys/outgoing.pack (already created) instead of key files.
+//Starts at checkpoint.keys_done, and saves the checkpoint after each window of keys is on disk.
+//Returns false if a key failed a health test (health tells which), having written none from it on,
+//or if keys could not be written or synced (health.failed stays false): the checkpoint stays before them.
+bool keygen_stream_keys(int engine, const unsigned int user_seeds[90], int thread_count, bool packed, keygen_checkpoint& checkpoint, keygen_health& health)
+{	int first_key = checkpoint.keys_done;
+	int resumed_from = first_key;
+	bool write_failed = false;
+	if(engine == 0)
+	{	vector<unsigned char> table_private(keygen_table_size, 0);
+		keygen_v2_serial(table_private.data(), keygen_table_size, user_seeds, true);
+		keygen_write_window(table_private.data() + (first_key * 2000014LL), first_key, 250 - first_key, packed, &health, &write_failed);
+		secure_wipe_parallel(table_private.data(), keygen_table_size, thread_count);
+		if((write_failed == false) && (health.failed == false) && (keygen_sync_keys() == false)) {write_failed = true;}
+		return ((health.failed == false) && (write_failed == false));
+	}
+	
+	int keys_per_window = ((keygen_memory_cap / 2) / 2000014);
+	if(keys_per_window < 1) {keys_per_window = 1;}
+	vector<unsigned char> windows[2];
+	windows[0].resize(keys_per_window * 2000014LL);
+	windows[1].resize(keys_per_window * 2000014LL);
+	
+	thread writer;
+	int turn = 0;
+	int keys_written = first_key; //By the writer thread, once joined.
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(; first_key < 250; first_key += keys_per_window)
+	{	int key_count = keys_per_window;
+		if((first_key + key_count) > 250) {key_count = (250 - first_key);}
+		long long window_start  = (first_key * 2000014LL);
+		long long window_length = (key_count * 2000014LL);
+		unsigned char* window = windows[turn].data();
+		
+		if(engine == 3) {keygen_v3_fill(window, window_start, window_length, user_seeds, thread_count);}
+		else
+		{	for(long long a = 0; a < window_length; a++) {window[a] = 0;} //The v2.2 engine adds into the window.
+			keygen_v2_parallel(window, window_start, window_length, keygen_table_size, user_seeds, thread_count);
+		}
+		
+		if(writer.joinable() == true)
+		{	writer.join();
+			if((health.failed == true) || (write_failed == true)) {break;}
+			if(keygen_sync_keys() == false) {write_failed = true; break;}
+			int keys_saved = checkpoint.keys_done;
+			checkpoint.keys_done = keys_written;
+			if(keygen_checkpoint_save(checkpoint) == false) {checkpoint.keys_done = keys_saved; write_failed = true; break;}
+		}
+		keygen_print_progress(first_key + key_count, resumed_from, start);
+		writer = thread(keygen_write_window, window, first_key, key_count, packed, &health, &write_failed);
+		keys_written = (first_key + key_count);
+		turn = (1 - turn);
+	}
+	if(writer.joinable() == true) {writer.join();}
+	if((health.failed == false) && (write_failed == false) && (keygen_sync_keys() == false)) {write_failed = true;}
+	cout << "\n";
+	
+	//Overwrites RAM of both windows.
+	secure_wipe_parallel(windows[0].data(), windows[0].size(), thread_count);
+	secure_wipe_parallel(windows[1].data(), windows[1].size(), thread_count);
+	return ((health.failed == false) && (write_failed == false));
+}
+
+/*##############################################################################
+Batch mode (options 5 and 6.) Encrypts every file in folder batch.plainfiles or
+decrypts every file in batch.cipherfiles, in file name order, with consecutive
+keys: the Nth file in name order gets the Nth key left. Each cipherfile is named
+by the position of its key (cipherfile.00130 for key position 130), and so is
+its plainfile on the other side. Every key handed out is used up, the key of a
+file that failed too (it may have encrypted something that reached the disk.)
+Decrypting cipherfiles so named, each gets the key of its own position, and the
+keys of any positions missing (files that failed on the other side) are used up
+in turn, so both sides stay in step whatever failed. Files go to a pool of
+worker threads; each worker reads its next key while encrypting the current
+file, and shreds the key it has just used while moving on. The remaining
+counter is written once, at the end.
+Large-file mode (options 7 and 8) hands the same pool one job per frame of one
+plainfile: frame N holds bytes N * class_size on, gets the Nth key left and is
+written at its own place in one cipherfile. Frames finish in any order but land
+in order, and each worker holds one key and one frame whatever the file size.
+##############################################################################*/
+struct batch_job
+{	string       input_name;
+	string       output_name;
+	long long    input_offset;  //Large-file mode: where this job's bytes are in input_name...
+	long long    input_length;  //...and how many. -1 = all of input_name (batch mode.)
+	long long    output_offset; //Large-file mode: where the result goes in output_name (made beforehand.) -1 = output_name is created.
+	long long    output_length; //Bytes written.
+	key_slot     key;
+	bool         done;
+	shred_report key_shred_report;
+};
+
+//Loads the key of one job (into frame[] unless packed.) Runs on its own thread while the worker's previous job is being encrypted.
+void batch_prefetch_key(batch_job* job, unsigned char frame[], bool* key_loaded)
+{	*key_loaded = key_load(job->key, frame);
+}
+
+//Reads a job's input to buffer[]: the whole file, or its range.
+bool batch_read_input(const batch_job& job, unsigned char buffer[], long long length)
+{	if(job.input_length == -1) {return (block_read_file (job.input_name.c_str(),                   buffer, length) == length);}
+	else                       {return (block_read_range(job.input_name.c_str(), job.input_offset, buffer, length) == length);}
+}
+
+bool batch_write_output(batch_job& job, const unsigned char buffer[], long long length)
+{	job.output_length = length;
+	if(job.output_offset == -1) {return block_write_file (job.output_name.c_str(),                    buffer, length);}
+	else                        {return block_write_range(job.output_name.c_str(), job.output_offset, buffer, length);}
+}
+
+void batch_worker(vector<batch_job>* jobs, atomic<int>* next_job, bool encrypting, long long class_size)
+{	int pieces = size_class_pieces(class_size);
+	vector<unsigned char> frames[2];
+	frames[0].resize(2000014);
+	frames[1].resize(2000014);
+	int  turn = 0;
+	bool key_loaded[2] = {false, false};
+	thread shredder; //One shred in flight per worker.
+	
+	int job_index = next_job->fetch_add(1);
+	if(job_index < (int)jobs->size()) {batch_prefetch_key(&(*jobs)[job_index], frames[turn].data(), &key_loaded[turn]);}
+	while(job_index < (int)jobs->size())
+	{	batch_job& job = (*jobs)[job_index];
+		unsigned char* frame = frames[turn].data();
+		
+		//Starts reading the key for this worker's next file.
+		int next_index = next_job->fetch_add(1);
+		thread prefetcher;
+		if(next_index < (int)jobs->size()) {prefetcher = thread(batch_prefetch_key, &(*jobs)[next_index], frames[1 - turn].data(), &key_loaded[1 - turn]);}
+		
+		job.done = false;
+		if((key_loaded[turn] == true) && (job.input_name.empty() == false)) //No input: a key skipped (see batch_assign_labeled_keys().)
+		{	if(encrypting == true)
+			{	long long file_size = job.input_length;
+				if(file_size == -1) {file_size = block_file_size(job.input_name.c_str());}
+				if(batch_read_input(job, frame + 7, file_size) == true)
+				{	frame_encrypt(frame, job.key.bytes, file_size, class_size, false);
+					job.done = batch_write_output(job, frame, class_size + 7);
+				}
+			}
+			else if(batch_read_input(job, frame, class_size + 7) == true)
+			{	bool compressed;
+				long long extracted_file_size = frame_decrypt(frame, job.key.bytes, class_size, &compressed);
+				vector<unsigned char> file;
+				if((compressed == true) && (job.input_length == -1) && (compress_expand_file(frame + 7, extracted_file_size, file) == true))
+				{	job.done = batch_write_output(job, file.data(), file.size());
+					secure_wipe(file.data(), file.size());
+				}
+				else {job.done = batch_write_output(job, frame + 7, extracted_file_size);} //Large-file frames are never packed.
+			}
+		}
+		secure_wipe(frame, 2000014);
+		
+		//Shreds the used key while the next file goes, failed or not (see Batch mode.)
+		//Size classes: every piece handed out is wiped, failed or not; batch_commit() shreds keys whose last piece went.
+		if((job.done == true) && (encrypting == true) && (job.input_length == -1)) {remove(job.input_name.c_str());} //Same as option 1: raw file removed.
+		if((job.done == false) && (job.output_offset == -1)) {remove(job.output_name.c_str());} //Nothing half written is left to send.
+		if(pieces == 1)
+		{	if(shredder.joinable() == true) {shredder.join();}
+			shredder = key_consume_async(job.key, &job.key_shred_report);
+		}
+		else if((pieces > 1) && (job.key.piece < (pieces - 1)) && (key_loaded[turn] == true))
+		{	if(shredder.joinable() == true) {shredder.join();}
+			shredder = key_consume_piece_async(job.key, &job.key_shred_report);
+		}
+		else {key_release(job.key);}
+		
+		if(prefetcher.joinable() == true) {prefetcher.join();}
+		turn = (1 - turn);
+		job_index = next_index;
+	}
+	if(shredder.joinable() == true) {shredder.join();}
+}
+
+//Gets the regular files in folder_name, sorted by name.
+vector<string> batch_list_folder(const char folder_name[])
+{	vector<string> file_names;
+	DIR* folder = opendir(folder_name);
+	if(folder == 0) {return file_names;}
+	for(struct dirent* entry = readdir(folder); entry != 0; entry = readdir(folder))
+	{	string path = string(folder_name) + "/" + entry->d_name;
+		struct stat file_status;
+		if((stat(path.c_str(), &file_status) == 0) && (S_ISREG(file_status.st_mode))) {file_names.push_back(entry->d_name);}
+	}
+	closedir(folder);
+	sort(file_names.begin(), file_names.end());
+	return file_names;
+}
+
+//Gives the Nth job the Nth key (or key piece) left, reserved for this process. Returns false (and gives them back) if there are not enough.
+bool batch_assign_keys(vector<batch_job>& jobs, vector<long long>& positions, const key_state& state, bool encrypting)
+{	int pieces = size_class_pieces(state.class_size);
+	positions.clear();
+	for(unsigned int a = 0; a < jobs.size(); a++)
+	{	long long position = key_reserve(state, encrypting);
+		if(position == -1)
+		{	if(positions.size() > 0) {key_unreserve(state, encrypting, positions.front(), positions.back() + 1);}
+			return false;
+		}
+		key_slot_set(jobs[a].key, key_state_outgoing(state, encrypting), (position / pieces), (position % pieces), state.class_size);
+		positions.push_back(position);
+		jobs[a].done = false;
+	}
+	return true;
+}
+
+//Gets the key position in a name such as cipherfile.00130, or -1 if name has none.
+long long batch_name_position(const string& name)
+{	size_t dot = name.rfind('.');
+	if((dot == string::npos) || ((name.size() - dot) < 2) || ((name.size() - dot) > 10)) {return -1;}
+	long long position = 0;
+	for(size_t a = (dot + 1); a < name.size(); a++)
+	{	if((name[a] < '0') || (name[a] > '9')) {return -1;}
+		position = ((position * 10) + (name[a] - 48));
+	}
+	return position;
+}
+
+//Names a batch output by its key position: prefix then 5 digits (30,375 positions at most, in the 4,096 class.)
+string batch_output_name(const string& prefix, long long position)
+{	char digits[16];
+	snprintf(digits, sizeof(digits), "%05lld", position);
+	return prefix + digits;
+}
+
+//Decrypting cipherfiles named by key position (jobs in position order, labels[] their positions): gives each the key of its
+//position, and adds a job with no input for each position in between, whose key is used up as the other side's was.
+//Returns false (and gives every key back) if a position is already behind the keys left here.
+bool batch_assign_labeled_keys(vector<batch_job>& jobs, const vector<long long>& labels, vector<long long>& positions, const key_state& state)
+{	int pieces = size_class_pieces(state.class_size);
+	vector<batch_job> labeled;
+	labeled.swap(jobs);
+	positions.clear();
+	for(unsigned int a = 0; a < labeled.size(); a++)
+	{	for(;;)
+		{	long long position = key_reserve(state, false);
+			if((position == -1) || (position > labels[a]))
+			{	if(position != -1) {positions.push_back(position);}
+				if(positions.size() > 0) {key_unreserve(state, false, positions.front(), positions.back() + 1);}
+				cout << "\n\n" << labeled[a].input_name << " needs key position " << labels[a] << ", but "
+				     << ((position == -1) ? string("no keys are left") : ("the next key left is at position " + to_string(position))) << ".\n";
+				jobs.clear();
+				return false;
+			}
+			batch_job job = labeled[a];
+			if(position < labels[a]) {job.input_name = ""; job.output_name = "";} //Skipped: the other side's file failed.
+			key_slot_set(job.key, key_state_outgoing(state, false), (position / pieces), (position % pieces), state.class_size);
+			job.done = false;
+			jobs.push_back(job);
+			positions.push_back(position);
+			if(position == labels[a]) {break;}
+		}
+	}
+	return true;
+}
+
+//Gets the bytes written by jobs done, for stats.
+long long batch_bytes_done(const vector<batch_job>& jobs)
+{	long long bytes = 0;
+	for(unsigned int a = 0; a < jobs.size(); a++) {if(jobs[a].done == true) {bytes += jobs[a].output_length;}}
+	return bytes;
+}
+
+//Runs every job on a pool of threads. Returns the thread count.
+int batch_execute(vector<batch_job>& jobs, bool encrypting, long long class_size)
+{	int thread_count = thread::hardware_concurrency();
+	if(thread_count < 1) {thread_count = 1;}
+	if(thread_count > (int)jobs.size()) {thread_count = jobs.size();}
+	atomic<int> next_job(0);
+	vector<thread> threads;
+	for(int t = 1; t < thread_count; t++) {threads.push_back(thread(batch_worker, &jobs, &next_job, encrypting, class_size));}
+	batch_worker(&jobs, &next_job, encrypting, class_size);
+	for(unsigned int t = 0; t < threads.size(); t++) {threads[t].join();}
+	return thread_count;
+}
+
+//Adjusts keys.state and the remaining counter by the keys used (every one handed out), once, and reports failures and
+//keys skipped. Returns the jobs done.
+int batch_commit(vector<batch_job>& jobs, const vector<long long>& positions, key_state& state, bool encrypting, bool* committed)
+{	int pieces = size_class_pieces(state.class_size);
+	int used = 0;
+	for(unsigned int a = 0; a < jobs.size(); a++)
+	{	if(jobs[a].done == true) {used++; continue;}
+		if(jobs[a].input_name.empty() == true) {cout << "\nKey position " << positions[a] << " skipped: the other side used it on a file that failed.";}
+		else if(pieces == 1) {cout << "\nFAILED: " << jobs[a].input_name << " (key " << jobs[a].key.name << " is used up all the same.)";}
+		else                 {cout << "\nFAILED: " << jobs[a].input_name << " (its piece of key " << jobs[a].key.name << " is wiped all the same.)";}
+	}
+	if(pieces == 1) {*committed = key_state_commit(state, encrypting, positions.back() + 1, jobs.size(), false);} //Each shredded by its worker.
+	else
+	{	//Shreds the keys whose last piece went. The next file starts after the last piece handed out, failed or not.
+		vector<thread> key_shredders;
+		for(unsigned int a = 0; a < jobs.size(); a++)
+		{	if(jobs[a].key.piece == (pieces - 1)) {key_shredders.push_back(key_consume_async(jobs[a].key, &jobs[a].key_shred_report));}
+		}
+		for(unsigned int a = 0; a < key_shredders.size(); a++) {key_shredders[a].join();}
+		*committed = key_state_commit(state, encrypting, positions.back() + 1, key_shredders.size(), false);
+	}
+	return used;
+}
+
+void batch_print_shred_report(const vector<batch_job>& jobs, int thread_count)
+{	double shred_seconds[2] = {0, 0};
+	int keys = 0, pieces = 0; //Whole keys (removed, or pack slots marked used), and used pieces wiped in place.
+	for(unsigned int a = 0; a < jobs.size(); a++)
+	{	if(jobs[a].done == false) {continue;}
+		if(jobs[a].key_shred_report.failed == true) {cout << "\nKey shredding FAILED for " << jobs[a].key.name << ", remove it by hand!";}
+		if(jobs[a].key_shred_report.kind == shred_kind_piece) {pieces++;}
+		else                                                  {keys++  ;}
+		shred_seconds[0] += jobs[a].key_shred_report.pass_seconds[0];
+		shred_seconds[1] += jobs[a].key_shred_report.pass_seconds[1];
+		stats_shred(jobs[a].key_shred_report, jobs[a].key.piece_length);
+	}
+	cout << keys << " keys and " << pieces << " used key pieces (wiped in place) ";
+	if(io_settings_get().shred_passes == 2) {cout << "shredded on " << thread_count << " threads: pass 1 (zeros) " << ((int)(shred_seconds[0] * 10000) / 10.0) << "ms, pass 2 (ones) ";}
+	else {cout << "shredded on " << thread_count << " threads in " << io_settings_get().shred_passes << " passes: zeros " << ((int)(shred_seconds[0] * 10000) / 10.0) << "ms, ones ";}
+	cout << ((int)(shred_seconds[1] * 10000) / 10.0) << "ms in total.\n";
+}
+
+//Option 5 (encrypting) and option 6. Returns once every file is done, with the exit status.
+int batch_run(bool encrypting)
+{	const char* input_folder  = "batch.plainfiles";
+	const char* output_folder = "batch.cipherfiles";
+	const char* output_prefix = "/cipherfile.";
+	if(encrypting == false) {input_folder = "batch.cipherfiles"; output_folder = "batch.plainfiles"; output_prefix = "/plainfile.";}
+	
+	key_state state;
+	if(key_state_load(state) == false) {cout << "\n\nNo keys here, get keys first.\n"; return 0;}
+	int files_left = key_state_files_left(state, encrypting);
+	long long class_size = state.class_size;
+	
+	vector<string> file_names = batch_list_folder(input_folder);
+	if(file_names.size() == 0) {cout << "\n\nPlace files in folder " << input_folder << " first (no files found there.)\n"; return 0;}
+	if((int)file_names.size() > files_left) {cout << "\n\n" << file_names.size() << " files but only " << files_left << " left to use keys for.\n"; return 0;}
+	
+	//Checks every file before any key is used, so a bad file can't break the key order halfway through.
+	for(unsigned int a = 0; a < file_names.size(); a++)
+	{	string path = string(input_folder) + "/" + file_names[a];
+		long long file_size = block_file_size(path.c_str());
+		if((encrypting == true ) && ((file_size < 1) || (file_size > class_size))) {cout << "\n\n" << path << " must be 1 to " << class_size << " bytes.\n"; return 0;}
+		if((encrypting == false) && (file_size != (class_size + 7)))               {cout << "\n\n" << path << " must be " << (class_size + 7) << " bytes.\n"; return 0;}
+	}
+	
+	//Cipherfiles named by key position get the key of theirs (in position order.) Other files: the Nth in name order gets the Nth key left.
+	vector<batch_job> jobs(file_names.size());
+	vector<long long> positions, labels;
+	for(unsigned int a = 0; (encrypting == false) && (a < file_names.size()); a++)
+	{	long long label = batch_name_position(file_names[a]);
+		if((label == -1) || (file_names[a].compare(0, 11, "cipherfile.") != 0)) {labels.clear(); break;}
+		labels.push_back(label);
+	}
+	if(labels.size() > 0)
+	{	vector<pair<long long, string> > by_position;
+		for(unsigned int a = 0; a < file_names.size(); a++) {by_position.push_back(make_pair(labels[a], file_names[a]));}
+		sort(by_position.begin(), by_position.end());
+		for(unsigned int a = 0; a < file_names.size(); a++) {labels[a] = by_position[a].first; file_names[a] = by_position[a].second;}
+	}
+	for(unsigned int a = 0; a < jobs.size(); a++)
+	{	jobs[a].input_name    = string(input_folder)  + "/" + file_names[a];
+		jobs[a].input_offset  =  0;
+		jobs[a].input_length  = -1;
+		jobs[a].output_offset = -1;
+	}
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	bool assigned;
+	if(labels.size() > 0) {assigned = batch_assign_labeled_keys(jobs, labels, positions, state);}
+	else
+	{	assigned = batch_assign_keys(jobs, positions, state, encrypting);
+		if(assigned == false) {cout << "\n\nNot enough key files left in this folder.\n";}
+	}
+	stats_end("key_reserve", phase_start, 0);
+	if(assigned == false) {return 0;}
+	for(unsigned int a = 0; a < jobs.size(); a++) //cipherfile.00130, and plainfile.00130 from it on the other side.
+	{	if(jobs[a].input_name.empty() == false) {jobs[a].output_name = batch_output_name(string(output_folder) + output_prefix, positions[a]);}
+	}
+	
+	cout << "\n" << file_names.size() << " files in " << input_folder << " go to " << output_folder << " with keys "
+	     << jobs.front().key.name << " to " << jobs.back().key.name << ". Continue? y/n: ";
+	char wait; cin >> wait;
+	if(wait != 'y')
+	{	if(key_unreserve(state, encrypting, positions.front(), positions.back() + 1) == false) {cout << "\nAnother process took keys meanwhile: the keys shown are skipped, remove them by hand on both sides.\n";}
+		return 0;
+	}
+	mkdir(output_folder, 0777);
+	
+	phase_start = stats_begin();
+	int thread_count = batch_execute(jobs, encrypting, class_size);
+	stats_end("batch_execute", phase_start, batch_bytes_done(jobs));
+	phase_start = stats_begin();
+	bool committed = true;
+	int used = batch_commit(jobs, positions, state, encrypting, &committed);
+	stats_end("counter_commit", phase_start, 0);
+	files_left = key_state_files_left(state, encrypting);
+	if((used < (int)jobs.size()) && (encrypting == true)) {cout << "\nFailed files are still in " << input_folder << ": the next run gives them new keys. Send the cipherfiles made\nas they are named, the other side skips the keys of those that failed.\n";}
+	
+	cout << "\n\n" << used << " of " << file_names.size() << " files now reside in " << output_folder << ". " << files_left << " left to use keys for.\n";
+	batch_print_shred_report(jobs, thread_count);
+	if(committed == false) {key_state_commit_warn(); return 1;}
+	return ((used < (int)jobs.size()) ? 1 : 0);
+}
+
+//Option 7 (encrypting) and option 8: plainfile of any size to one cipherfile of frames, or back. Returns the exit status.
+int stream_run(bool encrypting)
+{	key_state state;
+	if(key_state_load(state) == false) {cout << "\n\nNo keys here, get keys first.\n"; return 0;}
+	int files_left = key_state_files_left(state, encrypting);
+	long long class_size  = state.class_size;
+	long long frame_size  = (class_size + 7);
+	const char* input_name  = "plainfile";
+	const char* output_name = "cipherfile";
+	if(encrypting == false) {input_name = "cipherfile"; output_name = "plainfile";}
+	
+	if(encrypting == true) {cout << "\n\nPlace a copy of your file in this directory and rename it to \"plainfile\" without\nany extensions. Any size. Continue? y/n: ";}
+	else                   {cout << "\n\nPlace the cipherfile in this directory if not already here. Continue? y/n: "                                       ;}
+	char wait; cin >> wait; if(wait != 'y') {return 0;}
+	
+	//Cuts the input into frames.
+	long long input_size = block_file_size(input_name);
+	if(input_size < 1) {cout << "\n\n" << input_name << " not present or empty.\n"; return 0;}
+	if((encrypting == false) && ((input_size % frame_size) != 0)) {cout << "\n\ncipherfile must be a whole number of " << frame_size << "-byte frames.\n"; return 0;}
+	long long frame_count = (input_size / frame_size);
+	if(encrypting == true) {frame_count = ((input_size + class_size - 1) / class_size);}
+	if(frame_count > files_left) {cout << "\n\n" << input_name << " needs " << frame_count << " keys (or key pieces) but " << files_left << " are left.\n"; return 0;}
+	
+	vector<batch_job> jobs(frame_count);
+	vector<long long> positions;
+	for(long long a = 0; a < frame_count; a++)
+	{	jobs[a].input_name  = input_name;
+		jobs[a].output_name = output_name;
+		if(encrypting == true)
+		{	jobs[a].input_offset  = (a * class_size);
+			jobs[a].input_length  = class_size;
+			if(a == (frame_count - 1)) {jobs[a].input_length = (input_size - jobs[a].input_offset);}
+			jobs[a].output_offset = (a * frame_size);
+		}
+		else
+		{	jobs[a].input_offset  = (a * frame_size);
+			jobs[a].input_length  = frame_size;
+			jobs[a].output_offset = (a * class_size); //All frames but the last are full.
+		}
+	}
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	bool assigned = batch_assign_keys(jobs, positions, state, encrypting);
+	stats_end("key_reserve", phase_start, 0);
+	if(assigned == false) {cout << "\n\nNot enough key files left in this folder.\n"; return 0;}
+	cout << "\n" << input_name << " goes in " << frame_count << " frames to " << output_name << " with keys " << jobs.front().key.name << " to " << jobs.back().key.name << ".\n";
+	
+	//Makes the output file for the frames to be written into.
+	int file_descriptor = open(output_name, (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+	if(file_descriptor < 0)
+	{	key_unreserve(state, encrypting, positions.front(), positions.back() + 1);
+		cout << "\n\n" << output_name << " could not be written.\n";
+		return 0;
+	}
+	close(file_descriptor);
+	
+	phase_start = stats_begin();
+	int thread_count = batch_execute(jobs, encrypting, class_size);
+	stats_end("batch_execute", phase_start, batch_bytes_done(jobs));
+	phase_start = stats_begin();
+	bool committed = true;
+	int used = batch_commit(jobs, positions, state, encrypting, &committed);
+	stats_end("counter_commit", phase_start, 0);
+	if(used < (int)jobs.size())
+	{	remove(output_name);
+		if(encrypting == true) {cout << "\nNo cipherfile is made, and its keys (positions " << positions.front() << " to " << positions.back() << ") are used up. Send your next files\nwith option 5: they are named by key position, so the other side skips these keys.\n";}
+		else                   {cout << "\nNo plainfile is made, and the keys of this cipherfile are used up: ask the other side to send it again.\n";}
+		if(committed == false) {key_state_commit_warn();}
+		return 1;
+	}
+	
+	if(encrypting == true) {remove(input_name);} //Same as option 1: raw file removed.
+	else if(truncate(output_name, jobs.back().output_offset + jobs.back().output_length) != 0) {cout << "\n\nplainfile could not be cut to size.\n";}
+	cout << "\n\n" << output_name << " now resides in this directory. " << key_state_files_left(state, encrypting) << " left to use keys for.\n";
+	batch_print_shred_report(jobs, thread_count);
+	if(committed == false) {key_state_commit_warn(); return 1;}
+	return 0;
+}
+
+/*##############################################################################
+Symmetry digest (option 9.) Both sides hold the same keys folder, so both can
+print one short code and read it to each other to confirm nothing has drifted:
+no key removed on one side only, no counter adjusted on one side only. Each key
+left is hashed on its own (a key used or missing counts as gone), 125 of those
+make a folder's hash, and both folders' hashes with the remaining count of each
+channel and the size class make the code. Key files and key packs of the same
+keys give the same code. Keys are hashed in parallel, one per thread at a time.
+keys.digest keeps each key's hash with a stamp of its file (or pack slot) so a
+quick rerun hashes only keys changed since: in practice the one being used. The
+code is a 64-bit hash of the keys, nothing more; used keys can't be recovered.
+##############################################################################*/
+const unsigned long long digest_prime[5] = {0x9E3779B185EBCA87ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x85EBCA77C2B2AE63ULL, 0x27D4EB2F165667C5ULL};
+
+struct digest_leaf
+{	long long          stamp[3]; //Key file: inode, size, modified (ns.) Pack slot: pack inode, used, pieces wiped. All 0: gone.
+	unsigned long long hash;     //0 if gone.
+};
+
+struct digest_cache
+{	char         magic[8];    //"OTPdgst1"
+	int          class_size;
+	int          unused;      //0 (padding.)
+	digest_leaf  leaves[250]; //0 - 124 keys/incoming, 125 - 249 keys/outgoing.
+	unsigned int checksum;    //FNV-1a of all the above.
+};
+
+unsigned long long digest_rotate(unsigned long long x, int bits)
+{	return ((x << bits) | (x >> (64 - bits)));
+}
+
+unsigned long long digest_round(unsigned long long lane, unsigned long long word)
+{	return (digest_rotate(lane + (word * digest_prime[1]), 31) * digest_prime[0]);
+}
+
+//XXH64 of length bytes. Four lanes each take every fourth 8-byte word and don't depend on each other, so they run side by side.
+unsigned long long digest_hash(const unsigned char data[], long long length, unsigned long long seed)
+{	const unsigned char* end = (data + length);
+	unsigned long long hash;
+	if(length >= 32)
+	{	unsigned long long lanes[4] = {seed + digest_prime[0] + digest_prime[1], seed + digest_prime[1], seed, seed - digest_prime[0]};
+		for(; (end - data) >= 32; data += 32)
+		{	unsigned long long words[4];
+			memcpy(words, data, 32);
+			for(int a = 0; a < 4; a++) {lanes[a] = digest_round(lanes[a], words[a]);}
+		}
+		hash = (digest_rotate(lanes[0], 1) + digest_rotate(lanes[1], 7) + digest_rotate(lanes[2], 12) + digest_rotate(lanes[3], 18));
+		for(int a = 0; a < 4; a++) {hash = (((hash ^ digest_round(0, lanes[a])) * digest_prime[0]) + digest_prime[3]);}
+	}
+	else {hash = (seed + digest_prime[4]);}
+	hash += length;
+	
+	for(; (end - data) >= 8; data += 8)
+	{	unsigned long long word;
+		memcpy(&word, data, 8);
+		hash = ((digest_rotate(hash ^ digest_round(0, word), 27) * digest_prime[0]) + digest_prime[3]);
+	}
+	if((end - data) >= 4)
+	{	unsigned int word;
+		memcpy(&word, data, 4);
+		hash = ((digest_rotate(hash ^ (word * digest_prime[0]), 23) * digest_prime[1]) + digest_prime[2]);
+		data += 4;
+	}
+	for(; data < end; data++) {hash = (digest_rotate(hash ^ (*data * digest_prime[4]), 11) * digest_prime[0]);}
+	
+	hash ^= (hash >> 33); hash *= digest_prime[1];
+	hash ^= (hash >> 29); hash *= digest_prime[2];
+	hash ^= (hash >> 32);
+	return hash;
+}
+
+unsigned int digest_cache_checksum(const digest_cache& cache)
+{	const unsigned char* bytes = (const unsigned char*)&cache;
+	unsigned int hash = 2166136261u;
+	for(unsigned int a = 0; a < offsetof(digest_cache, checksum); a++) {hash = ((hash ^ bytes[a]) * 16777619u);}
+	return hash;
+}
+
+//Reads keys.digest. Returns false if it's missing, damaged or made for another size class.
+bool digest_cache_read(digest_cache& cache, int class_size)
+{	int file_descriptor = open("keys.digest", O_RDONLY);
+	if(file_descriptor < 0) {return false;}
+	bool valid = (read(file_descriptor, &cache, sizeof(cache)) == (ssize_t)sizeof(cache));
+	close(file_descriptor);
+	return ((valid == true) && (memcmp(cache.magic, "OTPdgst1", 8) == 0) && (cache.checksum == digest_cache_checksum(cache)) && (cache.class_size == class_size));
+}
+
+//Writes keys.digest.tmp, then renames it over keys.digest.
+void digest_cache_save(digest_cache& cache)
+{	memcpy(cache.magic, "OTPdgst1", 8);
+	cache.checksum = digest_cache_checksum(cache);
+	int file_descriptor = open("keys.digest.tmp", (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+	if(file_descriptor < 0) {return;}
+	bool written = (write(file_descriptor, &cache, sizeof(cache)) == (ssize_t)sizeof(cache));
+	close(file_descriptor);
+	if(written == true) {rename("keys.digest.tmp", "keys.digest");}
+	else                {remove("keys.digest.tmp");}
+}
+
+//Gets how many pieces from the start of a pack slot are wiped (see key_piece_blank().) Pieces are wiped in order, so this tells a slot changed.
+int digest_slot_pieces_wiped(const unsigned char slot[], long long class_size)
+{	long long piece_length = size_class_piece_length(class_size);
+	int pieces = size_class_pieces(class_size);
+	int wiped = 0;
+	for(; wiped < pieces; wiped++)
+	{	if(key_piece_blank(slot + (wiped * piece_length), piece_length) == false) {break;}
+	}
+	return wiped;
+}
+
+//Stamps leaf number (0 - 249) from its key file or pack slot. Returns where its bytes are: 0 if gone, else the slot in packs[],
+//or key_buffer after reading the key file into it (only if it must be hashed: stamp differs from cached.)
+const unsigned char* digest_leaf_locate(int number, const key_pack packs[2], long long class_size, const digest_leaf& cached, digest_leaf& leaf, unsigned char key_buffer[])
+{	bool outgoing = (number >= 125);
+	int  key_number = (number % 125);
+	memset(&leaf, 0, sizeof(leaf));
+	if(packs[outgoing].map != 0)
+	{	if(key_pack_slot_used(packs[outgoing], key_number) == true) {return 0;}
+		struct stat pack_status;
+		fstat(packs[outgoing].file_descriptor, &pack_status);
+		leaf.stamp[0] = pack_status.st_ino;
+		leaf.stamp[1] = 1;
+		leaf.stamp[2] = digest_slot_pieces_wiped(key_pack_slot(packs[outgoing], key_number), class_size);
+		return key_pack_slot(packs[outgoing], key_number);
+	}
+	
+	char file_name[20];
+	key_file_name(file_name, outgoing, key_number);
+	struct stat file_status;
+	if(stat(file_name, &file_status) != 0) {return 0;}
+	leaf.stamp[0] = file_status.st_ino;
+	leaf.stamp[1] = file_status.st_size;
+	leaf.stamp[2] = ((file_status.st_mtim.tv_sec * 1000000000LL) + file_status.st_mtim.tv_nsec);
+	if(memcmp(leaf.stamp, cached.stamp, sizeof(leaf.stamp)) == 0) {return key_buffer;} //Not read: the cached hash is taken.
+	long long length = block_read_file(file_name, key_buffer, 2000014);
+	if(length < 0) {memset(&leaf, 0, sizeof(leaf)); return 0;}
+	leaf.stamp[1] = length;
+	return key_buffer;
+}
+
+//Stamps and hashes leaves taken from a shared counter until none are left, reusing a cached hash when the stamp matches.
+//One of these runs per thread.
+void digest_worker(digest_cache* cache, const digest_cache* cached, const key_pack packs[2], long long class_size, atomic<int>* next_leaf, atomic<long long>* bytes_hashed)
+{	vector<unsigned char> key_buffer(2000014);
+	for(;;)
+	{	int number = next_leaf->fetch_add(1);
+		if(number >= 250) {return;}
+		digest_leaf& leaf = cache->leaves[number];
+		const unsigned char* key = digest_leaf_locate(number, packs, class_size, cached->leaves[number], leaf, key_buffer.data());
+		if(key == 0) {continue;}
+		if(memcmp(leaf.stamp, cached->leaves[number].stamp, sizeof(leaf.stamp)) == 0) {leaf.hash = cached->leaves[number].hash; continue;}
+		
+		long long length = 2000014;
+		if(key == key_buffer.data()) {length = leaf.stamp[1];}
+		leaf.hash = digest_hash(key, length, number + 1);
+		if(leaf.hash == 0) {leaf.hash = 1;} //0 is kept for gone.
+		*bytes_hashed += length;
+	}
+}
+
+//Gets a hash as 16 hexadecimal digits in groups of 4, to be read out.
+string digest_text(unsigned long long hash)
+{	char text[20];
+	snprintf(text, sizeof(text), "%04llX-%04llX-%04llX-%04llX", (hash >> 48), ((hash >> 32) & 0xFFFF), ((hash >> 16) & 0xFFFF), (hash & 0xFFFF));
+	return text;
+}
+
+//Option 9. Leaves keys.state as it is: the key maker may run it before sharing, when which side holds symmetry.entanglement
+//is not settled yet.
+void digest_run()
+{	key_state state;
+	if((key_state_read(state) == false) && (key_state_rebuild(state) == false)) {cout << "\n\nNo keys here, get keys first.\n"; return;}
+	if(state.entanglement == -1) {state.entanglement = file_exists("symmetry.entanglement");}
+	
+	cout << "\n(1) Hash all keys."
+	     << "\n(2) Hash only keys changed since the last digest (kept in keys.digest.)"
+	     << "\n\nEnter option: ";
+	int digest_option; cin >> digest_option;
+	if((digest_option != 1) && (digest_option != 2)) {cout << "\nInvalid, program ended.\n"; return;}
+	
+	//Starts from keys.digest (or from nothing: no stamp matches all zeros but a gone key, which needs no hash anyway.)
+	digest_cache cached;
+	memset(&cached, 0, sizeof(cached));
+	if((digest_option == 2) && (digest_cache_read(cached, state.class_size) == false))
+	{	cout << "\nNo usable keys.digest here, hashing all keys.\n";
+		memset(&cached, 0, sizeof(cached));
+	}
+	digest_cache cache;
+	memset(&cache, 0, sizeof(cache));
+	cache.class_size = state.class_size;
+	key_pack packs[2];
+	for(int folder = 0; folder < 2; folder++)
+	{	packs[folder].map = 0;
+		if(key_pack_exists(folder == 1) == true) {key_pack_open(packs[folder], (folder == 1));}
+	}
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	int thread_count = thread::hardware_concurrency();
+	if(thread_count < 1) {thread_count = 1;}
+	atomic<int> next_leaf(0);
+	atomic<long long> bytes_hashed(0);
+	vector<thread> threads;
+	for(int t = 1; t < thread_count; t++) {threads.push_back(thread(digest_worker, &cache, &cached, packs, (long long)state.class_size, &next_leaf, &bytes_hashed));}
+	digest_worker(&cache, &cached, packs, state.class_size, &next_leaf, &bytes_hashed);
+	for(unsigned int t = 0; t < threads.size(); t++) {threads[t].join();}
+	for(int folder = 0; folder < 2; folder++) {key_pack_close(packs[folder]);}
+	stats_end("digest", phase_start, bytes_hashed);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	//Folder hashes, then the code. Remaining counts go by channel (folder): one side's remaining.encrypt is the other's remaining.decrypt.
+	unsigned long long code_input[5];
+	int keys_left[2] = {0, 0};
+	for(int folder = 0; folder < 2; folder++)
+	{	unsigned long long folder_leaves[125];
+		for(int a = 0; a < 125; a++)
+		{	folder_leaves[a] = cache.leaves[(folder * 125) + a].hash;
+			if(folder_leaves[a] != 0) {keys_left[folder]++;}
+		}
+		code_input[folder] = digest_hash((const unsigned char*)folder_leaves, sizeof(folder_leaves), folder + 1);
+	}
+	for(int encrypting = 0; encrypting < 2; encrypting++)
+	{	code_input[2 + key_state_outgoing(state, (encrypting == 1))] = state.remaining[key_state_remaining_slot(state, (encrypting == 1))];
+	}
+	code_input[4] = state.class_size;
+	unsigned long long code = digest_hash((const unsigned char*)code_input, sizeof(code_input), 0);
+	digest_cache_save(cache);
+	
+	cout << "\n\nkeys/incoming:   " << digest_text(code_input[0]) << "  (" << keys_left[0] << " keys, " << code_input[2] << " left by the counter.)"
+	     <<   "\nkeys/outgoing:   " << digest_text(code_input[1]) << "  (" << keys_left[1] << " keys, " << code_input[3] << " left by the counter.)"
+	     << "\n\nSymmetry digest: " << digest_text(code) << "\n\nBoth sides must see the same digest. Hashed " << (bytes_hashed / 1000000) << "MB in " << (int)(seconds * 1000) << "ms.\n";
+}
+
+/*##############################################################################
+Key folder archive (schemeOTP --export=FILE, --import=FILE.) Export puts every
+key here (files or packs) into FILE, one after another, behind a header giving
+each one's place, length and checksum, so taking the keys to removable media is
+one sequential write at device speed, not 250 opens and closes. Keys are moved
+in 1MB chunks by copy_file_range(), which copies inside the kernel, or shares
+the blocks outright (a reflink) where the file system can: each key starts at a
+4,096-byte boundary in the archive for that. Each chunk is hashed as it lands,
+read back from the copy (still cached), so the checksum covers what was written
+and the source is read once. Import refuses a key whose checksum differs. The
+header holds keys.state as the OTHER side must have it: import writes the
+counters, size.class, swapped and symmetry.entanglement from it, so neither side
+removes symmetry.entanglement by hand. Exporting a folder fresh from option 3
+leaves it with the importer (the key maker's copy goes, as the option 3 message
+asked.) Import goes only into a folder without keys. Export holds keys.lock and
+pauses keys.reserve, so runs wait to take a key until it's done; it won't start
+while a key is taken and not yet used up (a run or the daemon has it.)
+##############################################################################*/
+const int archive_header_size = 16384; //Then the keys, each at a multiple of 4,096.
+const int archive_entries_max = 250;
+
+struct archive_entry
+{	char               name[24]; //"./keys/incoming/000" or "./keys/outgoing.pack"
+	long long          offset;   //In the archive.
+	long long          length;
+	unsigned long long checksum; //Of the chunk hashes, see archive_copy().
+};
+
+struct archive_header
+{	char               magic[8];                     //"OTParch1"
+	int                entry_count;
+	int                unused;                       //0 (padding.)
+	key_state          state;                        //keys.state for the importing side.
+	archive_entry      entries[archive_entries_max];
+	unsigned long long checksum;                     //XXH64 of all the above.
+};
+
+//Makes a relative archive name absolute, before --peer=ID changes folder.
+string archive_path(const char name[])
+{	if(name[0] == '/') {return name;}
+	char folder[4096];
+	if(getcwd(folder, sizeof(folder)) == 0) {return name;}
+	return string(folder) + "/" + name;
+}
+
+//Only key files and packs come out of an archive: any other name (say "../x") is refused.
+bool archive_entry_name_valid(const char name[])
+{	char file_name[20];
+	for(int folder = 0; folder < 2; folder++)
+	{	if(strcmp(name, key_pack_name(folder == 1)) == 0) {return true;}
+		for(int number = 0; number < 125; number++)
+		{	key_file_name(file_name, (folder == 1), number);
+			if(strcmp(name, file_name) == 0) {return true;}
+		}
+	}
+	return false;
+}
+
+//Reads length bytes at offset in file_descriptor into buffer[]. Returns false if they can't all be read.
+bool archive_read(int file_descriptor, long long offset, unsigned char buffer[], long long length)
+{	for(long long got = 0; got < length;)
+	{	ssize_t read_now = pread(file_descriptor, buffer + got, length - got, offset + got);
+		if((read_now < 0) && (errno == EINTR)) {continue;}
+		if(read_now <= 0) {return false;}
+		got += read_now;
+	}
+	return true;
+}
+
+//Copies length bytes at from_offset in from to to_offset in to, by copy_file_range() unless it's turned down (then through buffer[],
+//block_io_size bytes.) Every chunk is hashed as written: what the kernel copied is read back from to into buffer[], the rest is
+//read from from into buffer[] and written from there. Returns false if anything fails.
+bool archive_copy(int from, long long from_offset, int to, long long to_offset, long long length, unsigned long long& checksum,
+                  unsigned char buffer[], bool& in_kernel)
+{	checksum = 0;
+	for(long long done = 0; done < length;)
+	{	long long chunk = min(length - done, block_io_size);
+		long long put = 0;
+		while((in_kernel == true) && (put < chunk))
+		{	loff_t in = (from_offset + done + put), out = (to_offset + done + put);
+			ssize_t copied = copy_file_range(from, &in, to, &out, chunk - put, 0);
+			if((copied < 0) && (errno == EINTR)) {continue;}
+			if(copied <= 0) {in_kernel = false; break;} //Across file systems on old kernels, or not supported: the rest go through buffer[].
+			put += copied;
+		}
+		if(archive_read(to, (to_offset + done), buffer, put) == false) {return false;}
+		if(archive_read(from, (from_offset + done + put), buffer + put, chunk - put) == false) {return false;}
+		while(put < chunk)
+		{	ssize_t written = pwrite(to, buffer + put, chunk - put, to_offset + done + put);
+			if((written < 0) && (errno == EINTR)) {continue;}
+			if(written <= 0) {return false;}
+			put += written;
+		}
+		unsigned long long hashes[2] = {checksum, digest_hash(buffer, chunk, 0)};
+		checksum = digest_hash((const unsigned char*)hashes, sizeof(hashes), done);
+		done += chunk;
+	}
+	return true;
+}
+
+unsigned long long archive_header_checksum(const archive_header& header)
+{	return digest_hash((const unsigned char*)&header, offsetof(archive_header, checksum), 0);
+}
+
+//Writes this folder's keys to archive_name. Returns 0 if done.
+int archive_export(const string& archive_name)
+{	int lock = key_state_lock(); //Keeps other runs from committing keys meanwhile...
+	key_state state;
+	if((key_state_read(state) == false) && (key_state_rebuild(state) == false)) {key_state_unlock(lock); cout << "\nNo keys here to export.\n"; return 1;}
+	long long reserved[2];
+	key_reservations* paused = key_reserve_pause(reserved); //...and from taking them (they wait for keys.lock.)
+	if((reserved[0] > key_state_position(state, false)) || (reserved[1] > key_state_position(state, true)))
+	{	key_reserve_resume(paused);
+		key_state_unlock(lock);
+		cout << "\nA key here is taken and not yet used up (by a run or the daemon, or one that stopped midway.) Export when it's done,"
+		     << "\nor remove keys.reserve if nothing else runs here.\n";
+		return 1;
+	}
+	
+	//The importer holds symmetry.entanglement if this side doesn't. Fresh from option 3 (-1), this side gives it up.
+	bool fresh = (state.entanglement == -1);
+	if(fresh == true) {state.entanglement = 0;}
+	vector<unsigned char> header_page(archive_header_size, 0);
+	archive_header* header = (archive_header*)header_page.data();
+	memcpy(header->magic, "OTParch1", 8);
+	header->state = state;
+	header->state.entanglement = (1 - state.entanglement);
+	swap(header->state.remaining[0], header->state.remaining[1]); //One side's remaining.encrypt is the other's remaining.decrypt.
+	memcpy(header->state.magic, "OTPstate", 8);
+	header->state.version  = 2;
+	header->state.checksum = key_state_checksum(header->state);
+	
+	//Lists keys in order: packs, or the key files that are left.
+	long long offset = archive_header_size;
+	char file_name[20];
+	for(int folder = 0; folder < 2; folder++)
+	{	for(int number = 0; number < 125; number++)
+		{	const char* name = key_pack_name(folder == 1);
+			if(key_pack_exists(folder == 1) == false) {key_file_name(file_name, (folder == 1), number); name = file_name;}
+			long long length = block_file_size(name);
+			if(length < 0) {continue;}
+			archive_entry& entry = header->entries[header->entry_count++];
+			strcpy(entry.name, name);
+			entry.offset = offset;
+			entry.length = length;
+			offset += (((length + 4095) / 4096) * 4096);
+			if(name != file_name) {break;} //A pack holds the folder.
+		}
+	}
+	if(header->entry_count == 0) {key_reserve_resume(paused); key_state_unlock(lock); cout << "\nNo keys here to export.\n"; return 1;}
+	
+	int archive = open(archive_name.c_str(), (O_RDWR | O_CREAT | O_TRUNC), 0666);
+	if(archive < 0) {key_reserve_resume(paused); key_state_unlock(lock); cout << "\n" << archive_name << " could not be made.\n"; return 1;}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	vector<unsigned char> buffer(block_io_size);
+	bool in_kernel = true, exported = true;
+	for(int a = 0; (a < header->entry_count) && (exported == true); a++)
+	{	archive_entry& entry = header->entries[a];
+		int file_descriptor = open(entry.name, O_RDONLY);
+		exported = ((file_descriptor >= 0) && (archive_copy(file_descriptor, 0, archive, entry.offset, entry.length, entry.checksum, buffer.data(), in_kernel) == true));
+		if(file_descriptor >= 0) {close(file_descriptor);}
+	}
+	
+	//The header goes last, so an archive cut short has none.
+	header->checksum = archive_header_checksum(*header);
+	if(exported == true) {exported = ((ftruncate(archive, offset) == 0) && (pwrite(archive, header_page.data(), archive_header_size, 0) == archive_header_size));}
+	if(fsync(archive) != 0) {exported = false;}
+	if(close(archive) != 0) {exported = false;}
+	stats_end("export", phase_start, offset);
+	if(exported == false) {key_reserve_resume(paused); key_state_unlock(lock); remove(archive_name.c_str()); cout << "\nExport to " << archive_name << " FAILED (removed.)\n"; return 1;}
+	
+	if(fresh == true)
+	{	remove("symmetry.entanglement");
+		key_state_save(state);
+	}
+	key_reserve_resume(paused);
+	key_state_unlock(lock);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "\nExported " << header->entry_count << ((header->entry_count == 1) ? " file, " : " files, ") << (offset / 1000000) << "MB in " << (int)(seconds * 1000) << "ms"
+	     << ((in_kernel == true) ? " (copy_file_range.)" : " (read and written: copy_file_range turned down.)")
+	     << "\nTake " << archive_name << " to the other side in private. There, run schemeOTP --import=FILE in an empty folder.\n";
+	if(fresh == true) {cout << "symmetry.entanglement is removed here and goes with the archive.\n";}
+	return 0;
+}
+
+//Takes out every key of archive_name and sets this folder up as the other side. Returns 0 if done.
+int archive_import(const string& archive_name)
+{	if((file_exists("keys") == true) || (file_exists("keys.state") == true) || (file_exists("remaining.encrypt.txt") == true))
+	{	cout << "\nThere are keys here already. Import into an empty folder.\n"; return 1;
+	}
+	int archive = open(archive_name.c_str(), O_RDONLY);
+	if(archive < 0) {cout << "\n" << archive_name << " could not be opened.\n"; return 1;}
+	vector<unsigned char> header_page(archive_header_size, 0);
+	archive_header* header = (archive_header*)header_page.data();
+	long long archive_length = block_file_size(archive_name.c_str());
+	bool valid = ((pread(archive, header_page.data(), archive_header_size, 0) == archive_header_size) && (memcmp(header->magic, "OTParch1", 8) == 0)
+	           && (header->checksum == archive_header_checksum(*header)) && (header->entry_count > 0) && (header->entry_count <= archive_entries_max)
+	           && (header->state.checksum == key_state_checksum(header->state)));
+	for(int a = 0; (valid == true) && (a < header->entry_count); a++)
+	{	const archive_entry& entry = header->entries[a];
+		valid = ((memchr(entry.name, 0, sizeof(entry.name)) != 0) && (archive_entry_name_valid(entry.name) == true) && (entry.offset >= archive_header_size)
+		      && (entry.length >= 0) && ((entry.offset + entry.length) <= archive_length));
+	}
+	if(valid == false) {close(archive); cout << "\n" << archive_name << " is not a whole key archive.\n"; return 1;}
+	
+	mkdir("keys"           , 0777);
+	mkdir("keys/incoming"  , 0777);
+	mkdir("keys/outgoing"  , 0777);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	vector<unsigned char> buffer(block_io_size);
+	bool in_kernel = true, imported = true;
+	long long bytes = 0;
+	int a = 0;
+	for(; (a < header->entry_count) && (imported == true); a++)
+	{	const archive_entry& entry = header->entries[a];
+		int file_descriptor = open(entry.name, (O_RDWR | O_CREAT | O_TRUNC), 0666); //Read back for the checksum.
+		unsigned long long checksum = 0;
+		imported = ((file_descriptor >= 0) && (archive_copy(archive, entry.offset, file_descriptor, 0, entry.length, checksum, buffer.data(), in_kernel) == true));
+		if(file_descriptor >= 0) {close(file_descriptor);}
+		if((imported == true) && (checksum != entry.checksum)) {cout << "\n" << entry.name << " does not match its checksum in the archive."; imported = false;}
+		bytes += entry.length;
+	}
+	close(archive);
+	if(keygen_sync_keys() == false) {imported = false;}
+	stats_end("import", phase_start, bytes);
+	
+	//Key material written so far is shredded, not just removed: a few files at a time, each on its own thread.
+	if(imported == false)
+	{	int thread_count = thread::hardware_concurrency();
+		if(thread_count < 1) {thread_count = 1;}
+		bool shredded = true;
+		for(int b = 0; b < a; b += thread_count)
+		{	vector<thread>       shredders;
+			vector<shred_report> reports(thread_count);
+			for(int c = b; (c < a) && (c < (b + thread_count)); c++)
+			{	if(file_exists(header->entries[c].name) == true) {shredders.push_back(shred_file_async(header->entries[c].name, &reports[c - b]));}
+			}
+			for(unsigned int c = 0; c < shredders.size(); c++)
+			{	shredders[c].join();
+				if(reports[c].failed == true) {shredded = false;}
+			}
+		}
+		rmdir("keys/incoming");
+		rmdir("keys/outgoing");
+		rmdir("keys");
+		if(shredded == true) {cout << "\nImport from " << archive_name << " FAILED, what was written is shredded. Export it again.\n";}
+		else {cout << "\nImport from " << archive_name << " FAILED, and shredding what was written FAILED too: remove folder keys by hand!\n";}
+		return 1;
+	}
+	
+	//Sets this side up from the state in the archive: counters, size class, then marker files, then keys.state.
+	key_state state = header->state;
+	remaining_write("remaining.encrypt.txt", state.remaining[0], true );
+	remaining_write("remaining.decrypt.txt", state.remaining[1], false);
+	size_class_write(state.class_size);
+	ofstream out_stream;
+	if(state.swapped == 1)
+	{	out_stream.open("swapped");
+		out_stream << 1;
+		out_stream.close();
+	}
+	if(state.entanglement == 1)
+	{	out_stream.open("symmetry.entanglement");
+		out_stream << "This side keeps this file. (Set by --import, the other side has none.)";
+		out_stream.close();
+	}
+	key_state_save(state);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "\nImported " << header->entry_count << ((header->entry_count == 1) ? " file, " : " files, ") << (bytes / 1000000) << "MB in " << (int)(seconds * 1000) << "ms"
+	     << ((in_kernel == true) ? " (copy_file_range)" : " (read and written: copy_file_range turned down)") << ", every checksum matches.\n"
+	     << "symmetry.entanglement " << ((state.entanglement == 1) ? "is kept here" : "stays with the other side") << ". Remove the archive (it holds the keys.)\n";
+	return 0;
+}
+
+/*##############################################################################
+Daemon mode (schemeOTP --daemon.) One long-running process serves encrypt and
+decrypt requests from programs on this machine through Unix socket file named
+schemeOTP.socket in this folder, so no message pays for a new process, the menu
+or a key read from a cold disk. The next daemon_prefetch_keys keys (or pieces)
+of each direction are reserved and read ahead into memory locked against swap,
+while no request waits. A keeper thread shreds used keys and commits keys.state
+off the reply path. One epoll loop serves every client.   Request: 1 byte ('e'
+encrypt, 'd' decrypt), 8-byte payload length (host order), payload (the file or
+one cipherfile frame.) Reply: 1 byte (0 done, 1 refused), 8-byte length, then a
+cipherfile frame, the file, or why refused. Requests on one connection are done
+in order. A client that sends faster than it reads its replies is not read from
+while daemon_replies_max replies wait for it, so it can't pile up memory (or use
+up keys) past that. Stop with Ctrl+C or SIGTERM: keys read ahead but unused are
+returned.
+##############################################################################*/
+const int   daemon_prefetch_keys = 2;                  //Keys (or pieces) read ahead per direction.
+const int   daemon_header_size   = 9;                  //Request and reply: 1 byte, then an 8-byte length.
+const int   daemon_replies_max   = 4;                  //Of the largest size, waiting for one client. Its requests wait past that.
+const char* daemon_socket_name   = "schemeOTP.socket";
+
+struct daemon_key
+{	key_slot       key;
+	long long      position;
+	unsigned char* buffer;   //Locked in RAM. The key is read here, unless it's in a pack (then its pages are locked.)
+};
+
+struct daemon_direction
+{	daemon_key ring[daemon_prefetch_keys];
+	int        first;
+	int        count;
+	bool       depleted; //Nothing left to reserve: no more reading ahead.
+};
+
+struct daemon_used_key
+{	key_slot  key;
+	long long position;
+	bool      encrypting;
+	bool      last_piece; //The whole key goes.
+	bool      stop;       //Tells the keeper to end.
+};
+
+struct daemon_keeper
+{	mutex                  lock;
+	condition_variable     wake;
+	deque<daemon_used_key> queue;
+};
+
+struct daemon_client
+{	int                   file_descriptor;
+	vector<unsigned char> input;
+	vector<unsigned char> output;
+	size_t                output_sent;
+	bool                  hung_up; //Sent all it will: closed once its replies are out.
+};
+
+//Gets length bytes of memory locked in RAM. Sets *locked to false if the lock was refused (see ulimit -l.)
+unsigned char* daemon_locked_buffer(long long length, bool* locked)
+{	void* memory = mmap(0, length, (PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+	if(memory == MAP_FAILED) {return 0;}
+	if(mlock(memory, length) != 0) {*locked = false;}
+	return (unsigned char*)memory;
+}
+
+//Reserves and reads the next key (or piece) of one direction into its ring. Returns false if none was read.
+bool daemon_prefetch(daemon_direction& direction, const key_state& state, bool encrypting)
+{	if((direction.depleted == true) || (direction.count == daemon_prefetch_keys)) {return false;}
+	daemon_key& next = direction.ring[(direction.first + direction.count) % daemon_prefetch_keys];
+	int pieces = size_class_pieces(state.class_size);
+	long long position = key_reserve(state, encrypting);
+	if(position == -1) {direction.depleted = true; return false;}
+	
+	key_slot_set(next.key, key_state_outgoing(state, encrypting), (position / pieces), (position % pieces), state.class_size);
+	chrono::steady_clock::time_point phase_start = stats_begin();
+	bool loaded = key_load(next.key, next.buffer);
+	stats_end("key_prefetch", phase_start, next.key.piece_length);
+	if(loaded == false)
+	{	key_unreserve(state, encrypting, position, position + 1);
+		direction.depleted = true;
+		cout << "\nKey " << next.key.name << " is damaged: no more requests served this way.\n";
+		return false;
+	}
+	if(next.key.bytes != next.buffer) //In a pack: locking its pages also reads them from disk now.
+	{	unsigned char* first_page = (unsigned char*)(((unsigned long long)next.key.bytes) & ~4095ULL);
+		mlock(first_page, (next.key.bytes + next.key.piece_length) - first_page);
+	}
+	next.position = position;
+	direction.count++;
+	return true;
+}
+
+//Shreds used keys and commits them, in the order served. Runs on its own thread until told to stop.
+void daemon_keeper_run(daemon_keeper* keeper, key_state state)
+{	for(;;)
+	{	unique_lock<mutex> hold(keeper->lock);
+		while(keeper->queue.size() == 0) {keeper->wake.wait(hold);}
+		daemon_used_key used = keeper->queue.front();
+		keeper->queue.pop_front();
+		hold.unlock();
+		if(used.stop == true) {return;}
+		
+		shred_report key_shred_report;
+		thread key_shredder;
+		if(used.last_piece == true) {key_shredder = key_consume_async      (used.key, &key_shred_report);}
+		else                        {key_shredder = key_consume_piece_async(used.key, &key_shred_report);}
+		key_shredder.join();
+		stats_shred(key_shred_report, used.key.piece_length);
+		if(key_shred_report.failed == true) {cout << "\nShredding " << used.key.name << " FAILED, remove the used key by hand!\n";}
+		chrono::steady_clock::time_point phase_start = stats_begin();
+		if(key_state_commit(state, used.encrypting, used.position + 1, (used.last_piece == true) ? 1 : 0, false) == false) {key_state_commit_warn();}
+		stats_end("counter_commit", phase_start, 0);
+	}
+}
+
+void daemon_keeper_push(daemon_keeper& keeper, const daemon_used_key& used)
+{	lock_guard<mutex> hold(keeper.lock);
+	keeper.queue.push_back(used);
+	keeper.wake.notify_one();
+}
+
+//Appends a reply header to output and makes room for length bytes after it. Returns where they go.
+unsigned char* daemon_reply(vector<unsigned char>& output, unsigned char status, long long length)
+{	size_t header_at = output.size();
+	output.resize(header_at + daemon_header_size + length);
+	output[header_at] = status;
+	memcpy(&output[header_at + 1], &length, 8);
+	return &output[header_at + daemon_header_size];
+}
+
+void daemon_refuse(vector<unsigned char>& output, const string& message)
+{	memcpy(daemon_reply(output, 1, message.size()), message.data(), message.size());
+}
+
+//Encrypts or decrypts one payload with the next key read ahead, and appends the reply. The key goes to the keeper.
+void daemon_serve(daemon_client& client, const unsigned char payload[], long long length, bool encrypting, daemon_direction directions[2], daemon_keeper& keeper, const key_state& state)
+{	long long class_size = state.class_size;
+	if((encrypting == true ) && ((length < 1) || (length > class_size))) {daemon_refuse(client.output, "File must be 1 to " + to_string(class_size) + " bytes."); return;}
+	if((encrypting == false) && (length != (class_size + 7)))            {daemon_refuse(client.output, "Cipherfile must be " + to_string(class_size + 7) + " bytes."); return;}
+	
+	daemon_direction& direction = directions[encrypting];
+	if(direction.count == 0) {daemon_prefetch(direction, state, encrypting);} //Requests came faster than reading ahead.
+	if(direction.count == 0) {daemon_refuse(client.output, "No keys left this way."); return;}
+	daemon_key& next = direction.ring[direction.first];
+	
+	if(encrypting == true)
+	{	unsigned char* frame = daemon_reply(client.output, 0, class_size + 7);
+		memcpy(frame + 7, payload, length);
+		frame_encrypt(frame, next.key.bytes, length, class_size, false);
+	}
+	else
+	{	size_t header_at = client.output.size();
+		unsigned char* frame = daemon_reply(client.output, 0, class_size + 7);
+		memcpy(frame, payload, length);
+		bool compressed;
+		long long extracted_file_size = frame_decrypt(frame, next.key.bytes, class_size, &compressed);
+		vector<unsigned char> file;
+		if((compressed == true) && (compress_expand_file(frame + 7, extracted_file_size, file) == true))
+		{	secure_wipe(frame, class_size + 7);
+			extracted_file_size = file.size();
+			client.output.resize(header_at + daemon_header_size + extracted_file_size);
+			memcpy(&client.output[header_at + daemon_header_size], file.data(), extracted_file_size);
+			secure_wipe(file.data(), file.size());
+		}
+		else
+		{	memmove(frame, frame + 7, extracted_file_size);
+			secure_wipe(frame + extracted_file_size, (class_size + 7) - extracted_file_size);
+			client.output.resize(header_at + daemon_header_size + extracted_file_size);
+		}
+		memcpy(&client.output[header_at + 1], &extracted_file_size, 8);
+	}
+	
+	daemon_used_key used;
+	used.key        = next.key;
+	used.position   = next.position;
+	used.encrypting = encrypting;
+	used.last_piece = (next.key.piece == (size_class_pieces(class_size) - 1));
+	used.stop       = false;
+	if(next.key.bytes == next.buffer) {secure_wipe(next.buffer, next.key.piece_length);}
+	direction.first = ((direction.first + 1) % daemon_prefetch_keys);
+	direction.count--;
+	daemon_keeper_push(keeper, used);
+}
+
+//Gets the most a client may have waiting each way: replies not yet sent, and requests not yet served (2 of the largest.)
+size_t daemon_output_max(const key_state& state) {return (daemon_replies_max * (daemon_header_size + state.class_size + 7));}
+size_t daemon_input_max (const key_state& state) {return (2                  * (daemon_header_size + state.class_size + 7));}
+
+//Returns true if a client may be read from: its replies waiting and its requests waiting are both under their limits.
+bool daemon_client_has_room(const daemon_client& client, const key_state& state)
+{	return (((client.output.size() - client.output_sent) < daemon_output_max(state)) && (client.input.size() < daemon_input_max(state)));
+}
+
+//Returns true if a whole request waits in client.input (served once its replies are taken.)
+bool daemon_request_waiting(const daemon_client& client)
+{	if(client.input.size() < (size_t)daemon_header_size) {return false;}
+	long long length;
+	memcpy(&length, &client.input[1], 8);
+	return ((length >= 0) && ((client.input.size() - daemon_header_size) >= (unsigned long long)length));
+}
+
+//Reads what a client sent and serves the whole requests in it, while its replies waiting stay under daemon_output_max().
+//Returns false if the connection broke or the protocol did.
+bool daemon_read(daemon_client& client, daemon_direction directions[2], daemon_keeper& keeper, const key_state& state, vector<double>& serve_seconds)
+{	unsigned char chunk[65536];
+	while(daemon_client_has_room(client, state) == true)
+	{	ssize_t got = read(client.file_descriptor, chunk, sizeof(chunk));
+		if(got > 0) {client.input.insert(client.input.end(), chunk, chunk + got); continue;}
+		if(got == 0) {client.hung_up = true; break;}
+		if(errno == EINTR) {continue;}
+		if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {break;}
+		return false;
+	}
+	secure_wipe(chunk, sizeof(chunk));
+	
+	size_t done = 0;
+	while(((client.input.size() - done) >= (size_t)daemon_header_size) && ((client.output.size() - client.output_sent) < daemon_output_max(state)))
+	{	unsigned char operation = client.input[done];
+		long long length;
+		memcpy(&length, &client.input[done + 1], 8);
+		if(((operation != 'e') && (operation != 'd')) || (length < 0) || (length > (state.class_size + 7))) {return false;}
+		if((client.input.size() - done - daemon_header_size) < (size_t)length) {break;} //The rest is on its way.
+		
+		chrono::steady_clock::time_point serve_start = chrono::steady_clock::now();
+		daemon_serve(client, &client.input[done + daemon_header_size], length, (operation == 'e'), directions, keeper, state);
+		serve_seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - serve_start).count());
+		stats_add((operation == 'e') ? "serve_encrypt" : "serve_decrypt", serve_seconds.back(), length);
+		done += (daemon_header_size + length);
+	}
+	secure_wipe(client.input.data(), done);
+	client.input.erase(client.input.begin(), client.input.begin() + done);
+	return true;
+}
+
+//Sends what waits for a client. Returns false if the client is gone.
+bool daemon_write(daemon_client& client)
+{	while(client.output_sent < client.output.size())
+	{	ssize_t put = send(client.file_descriptor, &client.output[client.output_sent], client.output.size() - client.output_sent, MSG_NOSIGNAL);
+		if(put > 0) {client.output_sent += put; continue;}
+		if((put < 0) && (errno == EINTR)) {continue;}
+		if((put < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {return true;}
+		return false;
+	}
+	secure_wipe(client.output.data(), client.output.size());
+	client.output.clear();
+	client.output_sent = 0;
+	return true;
+}
+
+void daemon_close(daemon_client* client, int poller, vector<daemon_client*>& clients)
+{	epoll_ctl(poller, EPOLL_CTL_DEL, client->file_descriptor, 0);
+	close(client->file_descriptor);
+	secure_wipe(client->input.data() , client->input.size() );
+	secure_wipe(client->output.data(), client->output.size());
+	clients.erase(find(clients.begin(), clients.end(), client));
+	delete client;
+}
+
+//Option --daemon: serves requests until SIGINT or SIGTERM. Returns the exit status.
+int daemon_run()
+{	key_state state;
+	if(key_state_load(state) == false) {cout << "\nNo keys here, get keys first.\n"; return 1;}
+	
+	//One daemon per folder: a socket that answers means one is running.
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, daemon_socket_name);
+	int listener = socket(AF_UNIX, (SOCK_STREAM | SOCK_CLOEXEC), 0);
+	if(connect(listener, (sockaddr*)&address, sizeof(address)) == 0) {close(listener); cout << "\nA daemon already serves this folder.\n"; return 1;}
+	close(listener);
+	remove(daemon_socket_name);
+	listener = socket(AF_UNIX, (SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC), 0);
+	if((listener < 0) || (bind(listener, (sockaddr*)&address, sizeof(address)) != 0) || (listen(listener, 64) != 0)) {cout << "\n" << daemon_socket_name << " could not be made.\n"; return 1;}
+	
+	//Ctrl+C and SIGTERM arrive through epoll instead, so the loop ends cleanly. (Blocked before the keeper starts, for it too.)
+	sigset_t stop_signals;
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT );
+	sigaddset(&stop_signals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &stop_signals, 0);
+	int signal_descriptor = signalfd(-1, &stop_signals, (SFD_NONBLOCK | SFD_CLOEXEC));
+	
+	int poller = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event event;
+	event.events = EPOLLIN; event.data.ptr = &listener;          epoll_ctl(poller, EPOLL_CTL_ADD, listener,          &event);
+	event.events = EPOLLIN; event.data.ptr = &signal_descriptor; epoll_ctl(poller, EPOLL_CTL_ADD, signal_descriptor, &event);
+	
+	bool locked = true;
+	daemon_direction directions[2]; //[0] decrypt, [1] encrypt.
+	for(int a = 0; a < 2; a++)
+	{	directions[a].first    = 0;
+		directions[a].count    = 0;
+		directions[a].depleted = false;
+		for(int b = 0; b < daemon_prefetch_keys; b++) {directions[a].ring[b].buffer = daemon_locked_buffer(2000014, &locked);}
+	}
+	if(locked == false) {cout << "\nKeys read ahead could not be locked in RAM (see ulimit -l), they may be swapped to disk.";}
+	
+	daemon_keeper keeper;
+	thread keeper_thread(daemon_keeper_run, &keeper, state);
+	vector<daemon_client*> clients;
+	vector<double> serve_seconds;
+	cout << "\nServing " << daemon_socket_name << ": " << key_state_files_left(state, true) << " left to encrypt, "
+	     << key_state_files_left(state, false) << " to decrypt. Ctrl+C stops.\n" << flush;
+	
+	epoll_event events[64];
+	bool running = true;
+	while(running == true)
+	{	//Reads a key ahead whenever no request waits (timeout 0), else sleeps until one comes.
+		int behind = -1;
+		if(directions[0].depleted == false && directions[0].count < daemon_prefetch_keys) {behind = 0;}
+		if(directions[1].depleted == false && directions[1].count < daemon_prefetch_keys && (behind == -1 || directions[1].count <= directions[0].count)) {behind = 1;}
+		int ready = epoll_wait(poller, events, 64, (behind == -1) ? -1 : 0);
+		if(ready < 0) {if(errno == EINTR) {continue;} break;}
+		if(ready == 0) {daemon_prefetch(directions[behind], state, (behind == 1)); continue;}
+		
+		for(int a = 0; a < ready; a++)
+		{	if(events[a].data.ptr == &signal_descriptor) {running = false; continue;}
+			if(events[a].data.ptr == &listener)
+			{	for(;;)
+				{	int file_descriptor = accept4(listener, 0, 0, (SOCK_NONBLOCK | SOCK_CLOEXEC));
+					if(file_descriptor < 0) {break;}
+					daemon_client* client = new daemon_client;
+					client->file_descriptor = file_descriptor;
+					client->output_sent     = 0;
+					client->hung_up         = false;
+					clients.push_back(client);
+					event.events = EPOLLIN; event.data.ptr = client; epoll_ctl(poller, EPOLL_CTL_ADD, file_descriptor, &event);
+				}
+				continue;
+			}
+			
+			//Serves and sends until the client's replies back up (it then waits for EPOLLOUT) or nothing is left to serve.
+			daemon_client* client = (daemon_client*)events[a].data.ptr;
+			bool open = true;
+			bool readable = ((events[a].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0);
+			do
+			{	if((readable == true) || (daemon_request_waiting(*client) == true)) {open = daemon_read(*client, directions, keeper, state, serve_seconds);}
+				if(open == true) {open = daemon_write(*client);}
+			}	while((open == true) && (client->output.size() == 0) && (daemon_request_waiting(*client) == true));
+			if((open == false) || ((client->hung_up == true) && (client->output.size() == 0))) {daemon_close(client, poller, clients); continue;}
+			
+			event.events = 0; event.data.ptr = client;
+			if((client->hung_up == false) && (daemon_client_has_room(*client, state) == true)) {event.events |= EPOLLIN;} //Else it must take its replies first.
+			if(client->output.size() > 0) {event.events |= EPOLLOUT;}
+			epoll_ctl(poller, EPOLL_CTL_MOD, client->file_descriptor, &event);
+		}
+	}
+	
+	//Gives back the keys read ahead (if no other process took later ones), then lets the keeper finish.
+	while(clients.size() > 0) {daemon_close(clients.back(), poller, clients);}
+	for(int a = 0; a < 2; a++)
+	{	daemon_direction& direction = directions[a];
+		if(direction.count > 0)
+		{	long long first = direction.ring[direction.first].position;
+			long long last  = direction.ring[(direction.first + direction.count - 1) % daemon_prefetch_keys].position;
+			if(key_unreserve(state, (a == 1), first, last + 1) == false) {cout << "\nAnother process took keys meanwhile: keys read ahead are skipped, remove them by hand on both sides.";}
+		}
+		for(int b = 0; b < direction.count; b++) {key_release(direction.ring[(direction.first + b) % daemon_prefetch_keys].key);}
+		for(int b = 0; b < daemon_prefetch_keys; b++)
+		{	secure_wipe(direction.ring[b].buffer, 2000014);
+			munmap(direction.ring[b].buffer, 2000014);
+		}
+	}
+	daemon_used_key stop;
+	stop.stop = true;
+	daemon_keeper_push(keeper, stop);
+	keeper_thread.join();
+	close(poller);
+	close(listener);
+	close(signal_descriptor);
+	remove(daemon_socket_name);
+	
+	sort(serve_seconds.begin(), serve_seconds.end());
+	cout << "\n\nServed " << serve_seconds.size() << " requests.";
+	if(serve_seconds.size() > 0) {cout << " 99% within " << ((int)(serve_seconds[(serve_seconds.size() * 99) / 100] * 10000) / 10.0) << "ms.";}
+	cout << "\n";
+	return 0;
+}
+
+/*##############################################################################
+Benchmarks (schemeOTP --bench.) Times each stage alone, in a fresh folder under
+TMPDIR (or /tmp) on synthetic keys, and removes it after: keygen v3 and v2.2 in
+MB/s, the cipher kernels and memory wiping in GB/s, key loading from disk (page
+cache dropped first) and from cache, cipherfile writes, and shredding with the
+I/O settings of the folder it's started in. One JSON object per line, for diffs
+between versions. CPU stages are run bench_repeats times and the best is shown.
+Still one file: g++ -O2 -pthread schemeOTP.cpp builds the menu, daemon and this
+(make bench builds it and runs the benchmarks.)
+##############################################################################*/
+const int       bench_repeats     =        3;
+const long long bench_memory_size = 67108864; //Bytes per CPU stage...
+const long long bench_keygen_size =  8388608; //...but keygen, which is far slower.
+const int       bench_keys        =       16; //Synthetic key files per I/O stage.
+
+double bench_seconds_since(chrono::steady_clock::time_point start)
+{	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//Prints one result line: {"benchmark": ..., "bytes": ..., "seconds": ..., "rate": ..., "unit": ...} plus extra fields.
+void bench_print(const char name[], long long bytes, double seconds, bool gigabytes, const string& extra_fields)
+{	double rate = ((seconds > 0) ? ((bytes / seconds) / (gigabytes ? 1e9 : 1e6)) : 0);
+	cout << "{\"benchmark\": \"" << name << "\", \"bytes\": " << bytes << ", \"seconds\": " << seconds
+	     << ", \"rate\": " << ((long long)(rate * 100) / 100.0) << ", \"unit\": \"" << (gigabytes ? "GB/s" : "MB/s") << "\"" << extra_fields << "}\n" << flush;
+}
+
+//Writes bench_keys synthetic keys to keys/outgoing, synced and (if drop_cache) evicted from the page cache.
+//Returns false if a key could not be written.
+bool bench_write_keys(const unsigned char key[], bool drop_cache)
+{	for(int a = 0; a < bench_keys; a++)
+	{	if(keygen_write_key(key, 125 + a, false) == false) {return false;}
+		char file_name[20];
+		key_file_name(file_name, true, a);
+		int file_descriptor = open(file_name, O_RDONLY);
+		if(file_descriptor < 0) {continue;}
+		fdatasync(file_descriptor);
+		if(drop_cache == true) {posix_fadvise(file_descriptor, 0, 0, POSIX_FADV_DONTNEED);}
+		close(file_descriptor);
+	}
+	return true;
+}
+
+double bench_load_keys(unsigned char buffer[])
+{	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int a = 0; a < bench_keys; a++)
+	{	key_slot key;
+		key_slot_set(key, true, a, 0, size_class_default);
+		key_load(key, buffer);
+		key_release(key);
+	}
+	return bench_seconds_since(start);
+}
+
+//Option --bench. Returns the exit status.
+int bench_run()
+{	int thread_count = thread::hardware_concurrency();
+	if(thread_count < 1) {thread_count = 1;}
+	io_settings_get(); //Read here, before moving to the scratch folder.
+	string threads_field = ", \"threads\": " + to_string(thread_count);
+	
+	const char* temp = getenv("TMPDIR");
+	string folder = string((temp != 0) ? temp : "/tmp") + "/schemeOTP.bench.XXXXXX";
+	if((mkdtemp(&folder[0]) == 0) || (chdir(folder.c_str()) != 0)) {cout << "\nNo scratch folder could be made in " << ((temp != 0) ? temp : "/tmp") << ".\n"; return 1;}
+	mkdir("keys", 0777);
+	mkdir("./keys/outgoing", 0777);
+	
+	vector<unsigned char> x(bench_memory_size), y(bench_memory_size);
+	unsigned int seeds[90];
+	for(int a = 0; a < 90; a++) {seeds[a] = (100000000 + (a * 9876543));} //Fixed, so every run does the same work.
+	
+	//Keygen: one option 3 window, without the disk.
+	double best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); keygen_v3_fill(x.data(), 0, bench_keygen_size, seeds, thread_count); best = min(best, bench_seconds_since(start));}
+	bench_print("keygen_v3", bench_keygen_size, best, false, threads_field);
+	best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); keygen_v2_parallel(y.data(), 0, bench_keygen_size, keygen_table_size, seeds, thread_count); best = min(best, bench_seconds_since(start));}
+	bench_print("keygen_v2", bench_keygen_size, best, false, threads_field);
+	
+	//Cipher kernels: whole buffers, as encrypt and decrypt run them on a frame.
+	string kernel_field = ", \"kernel\": \"";
+	cipher_add_bytes(x.data(), x.data(), y.data(), 1); //Picks the kernel before timing.
+	kernel_field += string(cipher_kernel_name) + "\"";
+	best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); cipher_add_bytes(x.data(), x.data(), y.data(), bench_memory_size); best = min(best, bench_seconds_since(start));}
+	bench_print("encrypt_kernel", bench_memory_size, best, true, kernel_field);
+	best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); cipher_subtract_bytes(x.data(), x.data(), y.data(), bench_memory_size); best = min(best, bench_seconds_since(start));}
+	bench_print("decrypt_kernel", bench_memory_size, best, true, kernel_field);
+	
+	//Memory wiping, on one thread and on all.
+	best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); secure_wipe(x.data(), bench_memory_size); best = min(best, bench_seconds_since(start));}
+	bench_print("secure_wipe", bench_memory_size, best, true, ", \"threads\": 1");
+	best = 1e9;
+	for(int r = 0; r < bench_repeats; r++) {chrono::steady_clock::time_point start = chrono::steady_clock::now(); secure_wipe_parallel(x.data(), bench_memory_size, thread_count); best = min(best, bench_seconds_since(start));}
+	bench_print("secure_wipe_parallel", bench_memory_size, best, true, threads_field);
+	
+	//Key loading: from disk, then from the page cache.
+	keygen_v3_fill(y.data(), 0, 2000014, seeds, 1);
+	long long key_bytes = (bench_keys * 2000014LL);
+	if(bench_write_keys(y.data(), true) == false)
+	{	for(int a = 0; a < bench_keys; a++) {char file_name[20]; key_file_name(file_name, true, a); remove(file_name);}
+		rmdir("./keys/outgoing");
+		rmdir("keys");
+		if(chdir("/") == 0) {rmdir(folder.c_str());}
+		cout << "\nKeys could not be written in " << folder << " (disk full?)\n";
+		return 1;
+	}
+	bench_print("key_load_disk", key_bytes, bench_load_keys(x.data()), false, "");
+	bench_print("key_load_cache", key_bytes, bench_load_keys(x.data()), false, "");
+	
+	//Cipherfile writes (to the page cache, as option 1 leaves them.)
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int a = 0; a < bench_keys; a++) {block_write_file(("cipherfile." + to_string(a)).c_str(), y.data(), 1000007);}
+	bench_print("cipherfile_write", (bench_keys * 1000007LL), bench_seconds_since(start), false, "");
+	for(int a = 0; a < bench_keys; a++) {remove(("cipherfile." + to_string(a)).c_str());}
+	
+	//Shredding: every pass synced, keys one after another as options 1 and 2 do.
+	shred_report report;
+	start = chrono::steady_clock::now();
+	for(int a = 0; a < bench_keys; a++)
+	{	char file_name[20];
+		key_file_name(file_name, true, a);
+		shred_file(file_name, &report);
+	}
+	bench_print("shred", key_bytes, bench_seconds_since(start), false, ", \"backend\": \"" + io_backend_name() + "\", \"passes\": " + to_string(io_settings_get().shred_passes));
+	
+	secure_wipe(y.data(), 2000014);
+	rmdir("./keys/outgoing");
+	rmdir("keys");
+	if((chdir("/") != 0) || (rmdir(folder.c_str()) != 0)) {cout << "\nScratch folder " << folder << " is left, remove it by hand.\n";}
+	return 0;
+}
+
+#ifndef SCHEMEOTP_LIBRARY
+int main(int argc, char* argv[])
+{	bool daemon = false, bench = false, compress = false;
+	const char* peer = 0;
+	string export_name, import_name;
+	for(int a = 1; a < argc; a++)
+	{	if     (strcmp (argv[a], "--daemon"  ) == 0) {daemon   = true;} //See Daemon mode.
+		else if(strcmp (argv[a], "--bench"   ) == 0) {bench    = true;} //See Benchmarks.
+		else if(strcmp (argv[a], "--compress") == 0) {compress = true;} //See Compression.
+		else if(strncmp(argv[a], "--peer=" , 7) == 0) {peer = (argv[a] + 7);} //See Channel registry.
+		else if(strncmp(argv[a], "--add-peer=", 11) == 0) {return (channel_add(argv[a] + 11) == true) ? 0 : 1;}
+		else if(strcmp (argv[a], "--channels") == 0) {return channel_list();}
+		else if(strncmp(argv[a], "--export=", 9) == 0) {export_name = archive_path(argv[a] + 9);} //See Key folder archive.
+		else if(strncmp(argv[a], "--import=", 9) == 0) {import_name = archive_path(argv[a] + 9);}
+		else if(strcmp (argv[a], "--health=warn") == 0) {health_warn_only = true;} //See Health tests.
+		else if(strncmp(argv[a], "--stats", 7) == 0) {if(stats_start(argv[a] + 7) == false) {cout << "\nStats log " << (argv[a] + 8) << " could not be opened.\n"; return 1;}} //See Stats.
+		else {cout << "\nUnknown option " << argv[a] << ". Options are --daemon, --bench, --compress, --stats (or --stats=log file),\n"
+		           << "--add-peer=ID, --peer=ID, --channels, --export=FILE, --import=FILE and --health=warn.\n"; return 1;}
+	}
+	if(bench  == true) {stats.mode = "bench" ; return  bench_run();}
+	if((peer != 0) && (channel_enter(peer) == false)) {return 1;}
+	if(export_name.empty() == false) {stats.mode = "export"; return archive_export(export_name);}
+	if(import_name.empty() == false) {stats.mode = "import"; return archive_import(import_name);}
+	if(daemon == true) {stats.mode = "daemon"; return daemon_run();}
+	
+	ifstream in_stream;
 	ofstream out_stream;
 	
 	cout << "\n(scheme One-time pad)\n\n"
@@ -75,7 +4156,12 @@ int main()
 	     << "(1) Encrypt\n"
 	     << "(2) Decrypt\n"
 	     << "(3) Get keys\n"
-	     << "(4) Swap channels\n\n";
+	     << "(4) Swap channels\n"
+	     << "(5) Batch encrypt\n"
+	     << "(6) Batch decrypt\n"
+	     << "(7) Encrypt large file\n"
+	     << "(8) Decrypt large file\n"
+	     << "(9) Symmetry digest\n\n";
 	
 	in_stream.open("swapped"); //Checks if file swapped exists.
 	if(in_stream.fail() == true)
@@ -88,8 +4174,9 @@ int main()
 	
 	int user_option;
 	cin >> user_option;
-	if((user_option != 1) && (user_option != 2) && (user_option != 3) && (user_option != 4)) {cout << "\nInvalid, program ended.\n"; return 0;}
-	//(You can run each of the four ifs holding options 1, 2, and 3, and 4 in isolation--they are self-sustained.)
+	if((user_option < 1) || (user_option > 9)) {cout << "\nInvalid, program ended.\n"; return 0;}
+	stats.mode = to_string(user_option);
+	//(You can run each of the ifs holding options 1 - 6 in isolation--they are self-sustained.)
 	
 	
 	
@@ -97,146 +4184,129 @@ int main()
 	
 	//______________________________________________________Encrypt___________________________________________________//
 	if(user_option == 1)
-	{	ifstream in_stream;
-		ofstream out_stream;
-		
-		//Checks if files exist.
-		in_stream.open("swapped");
-		if(in_stream.fail() == true) {in_stream.close(); in_stream.open("remaining.encrypt.txt");}
-		else                         {in_stream.close(); in_stream.open("remaining.decrypt.txt");}
-		
-		if(in_stream.fail() == true) {cout << "\n\nCan't encrypt without keys.\n"; in_stream.close(); return 0;}
-		char remaining_encrypt[3];
-		for(int a = 0; a < 3; a++) {in_stream >> remaining_encrypt[a]; remaining_encrypt[a] -= 48;}
-		in_stream.close();
-		
-		int remaining_encrypt_decimal = 0;
-		if(remaining_encrypt[ 0] > 0) {remaining_encrypt_decimal += (remaining_encrypt[ 0] * 100);}
-		if(remaining_encrypt[ 1] > 0) {remaining_encrypt_decimal += (remaining_encrypt[ 1] *  10);}
-		if(remaining_encrypt[ 2] > 0) {remaining_encrypt_decimal += (remaining_encrypt[ 2]      );}
-		if(remaining_encrypt_decimal == 0)   {cout << "\n\nEncryption keys depleted, consider swapping channels.\n"; return 0;}
+	{	//Checks if keys exist (keys.state, or the files it is rebuilt from.)
+		key_state state;
+		if(key_state_load(state) == false) {cout << "\n\nCan't encrypt without keys.\n"; return 0;}
+		int remaining_encrypt_decimal = key_state_files_left(state, true); //Files, not keys: one key serves many in a small size class.
+		long long class_size = state.class_size;
+		int pieces = size_class_pieces(class_size);
+		if(remaining_encrypt_decimal ==  0) {cout << "\n\nEncryption keys depleted, consider swapping channels.\n"; return 0;}
 		
 		//Instructing user to give the file.
 		if(remaining_encrypt_decimal == 1)   {cout << "\nYou may encrypt one more file." ;}
 		else {cout << "\nYou may encrypt " << remaining_encrypt_decimal << " more files.";}
 		
-		cout << "\n\nPlace a copy of your file in this directory and rename it to \"plainfile\" without\n"
-		     << "any extensions. Make sure it's 1 to 1,000,000 bytes in size. Continue? y/n: ";
+		cout << "\n\nPlace a copy of your file in this directory and rename it to \"plainfile\" without\n";
+		if     (compress   == true              ) {cout << "any extensions. Make sure it compresses to " << class_size << " bytes at most. Continue? y/n: ";}
+		else if(class_size == size_class_default) {cout << "any extensions. Make sure it's 1 to 1,000,000 bytes in size. Continue? y/n: "         ;}
+		else                                      {cout << "any extensions. Make sure it's 1 to " << class_size << " bytes in size. Continue? y/n: ";}
 		
 		char wait; cin >> wait; if(wait != 'y') {return 0;}
 		
-		//Maintaining symmetry entanglement.
-		char file_name_key_outgoing[20] = "./keys/outgoing/000";
-		in_stream.open("symmetry.entanglement");
-		if(in_stream.fail() == true)
-		{	file_name_key_outgoing[ 7] = 'i';
-			file_name_key_outgoing[ 8] = 'n';
-			file_name_key_outgoing[ 9] = 'c';
-			file_name_key_outgoing[10] = 'o';
-			file_name_key_outgoing[11] = 'm';
-		}
-		in_stream.close();
+		//Checks the file before taking a key for it.
+		long long file_size_counter = block_file_size("plainfile");
+		if(file_size_counter == -1)     {cout << "\n\nplainfile not present or misspelled.\n"; return 0;}
+		if(file_size_counter ==  0)     {cout << "\n\nplainfile cannot be empty.\n"        ; return 0;}
 		
-		//Generates key file NAME based on existence.
-		int file_numbering = 1000000; //Only the last 3 digits are used, size makes mod operations easier.
-		for(int a = 0; a < 125; a++)
-		{	in_stream.open(file_name_key_outgoing);
-			if(in_stream.fail() == false) {in_stream.close(); break;}
-			
-			//Adjusts file numbering.
-			file_numbering++;
-			int temp_file_numbering = file_numbering;
-			file_name_key_outgoing[18] = (temp_file_numbering % 10) + 48; //       ./keys/outgoing/0  0  0    (file name)
-			temp_file_numbering /=    10; //                                                       ^  ^  ^
-			file_name_key_outgoing[17] = (temp_file_numbering % 10) + 48; //                      16 17 18    (element layout)
-			temp_file_numbering /=    10;
-			file_name_key_outgoing[16] = (temp_file_numbering % 10) + 48;
+		//Packs plainfile, kept only if smaller (see Compression.) file_size_counter is then the packed size, the bytes a frame holds.
+		vector<unsigned char> compressed_file;
+		bool compressed = false;
+		if((compress == true) && (file_size_counter <= compress_max_expanded))
+		{	chrono::steady_clock::time_point phase_start = stats_begin();
+			vector<unsigned char> original(file_size_counter);
+			if(block_read_file("plainfile", original.data(), file_size_counter) != file_size_counter) {cout << "\n\nplainfile could not be read.\n"; return 0;}
+			compressed_file.resize(compress_bound(file_size_counter));
+			long long compressed_size = compress_bytes(original.data(), file_size_counter, compressed_file.data());
+			secure_wipe(original.data(), original.size());
+			stats_end("compress", phase_start, file_size_counter);
+			if(compressed_size < file_size_counter)
+			{	cout << "\nplainfile compressed from " << file_size_counter << " to " << compressed_size << " bytes.";
+				compressed = true;
+				file_size_counter = compressed_size;
+			}
 		}
+		if(file_size_counter > class_size) {cout << "\n\nplainfile too large!\n"           ; return 0;}
 		
-		//Gets key file for encryption.
-		unsigned char plainfile[2000014];
-		char temp_file_item;
-		int  temp_file_item_decimal;
-		in_stream.open(file_name_key_outgoing);
-		for(int a = 0; a < (2000014); a++)
-		{	in_stream.get(temp_file_item);
-			temp_file_item_decimal = temp_file_item;
-			if(temp_file_item_decimal < 0) {plainfile[a] = (temp_file_item_decimal + 256);}
-			else                           {plainfile[a] =  temp_file_item_decimal       ;}
-		}
-		in_stream.close();
+		//Reserves the next key (or piece) in keys/outgoing or keys/incoming (symmetry entanglement.) No other process gets it.
+		chrono::steady_clock::time_point run_start = chrono::steady_clock::now(); //Wall clock from here to the key shredded.
+		key_slot key_outgoing;
+		chrono::steady_clock::time_point phase_start = stats_begin();
+		long long position = key_reserve(state, true);
+		stats_end("key_reserve", phase_start, 0);
+		if(position == -1) {cout << "\n\nNo key files left in this folder.\n"; return 0;}
+		int key_number = (position / pieces);
+		int piece      = (position % pieces);
+		key_slot_set(key_outgoing, key_state_outgoing(state, true), key_number, piece, class_size);
 		
-		//Gets file items and overwrites plainfile[], leaving appended randomness.
-		int file_size_counter = 0;
-		in_stream.open("plainfile");
-		if(in_stream.fail() == true) {in_stream.close(); cout << "\n\nplainfile not present or misspelled.\n"; return 0;}
-		in_stream.get(temp_file_item);
-		if(in_stream.eof() == true) {cout << "\n\nplainfile cannot be empty.\n"; return 0;}
-		for(int a = 7; in_stream.eof() == false; a++)
-		{	file_size_counter++;
-			if(file_size_counter > 1000000) {cout << "\n\nplainfile too large!\n"; return 0;}
-			
-			temp_file_item_decimal = temp_file_item;
-			if(temp_file_item_decimal < 0) {temp_file_item_decimal += 256;}
-			plainfile[a] = temp_file_item_decimal;
-			
-			in_stream.get(temp_file_item);
+		//Gets key file for encryption (read into plainfile[], or read in place from a key pack) and the file over its first bytes,
+		//leaving appended randomness. Both reads at once (see Async I/O.)
+		unsigned char plainfile[2000014];
+		phase_start = stats_begin();
+		bool loaded;
+		if(compressed == false) {loaded = key_load_with_input(key_outgoing, plainfile, file_size_counter + 7, "plainfile", plainfile + 7, file_size_counter);}
+		else
+		{	loaded = key_load(key_outgoing, plainfile); //plainfile was read already.
+			if(loaded == true) {memcpy(plainfile + 7, compressed_file.data(), file_size_counter);}
+			secure_wipe(compressed_file.data(), compressed_file.size());
 		}
-		in_stream.close();
-		
-		//Writes the file size to the first 7 plainfile[] elements. This will be encrypted.
-		file_size_counter += 1000000000;
-		for(int a = 6; a >= 0; a--)
-		{	plainfile[a] = (file_size_counter % 10);
-			file_size_counter /= 10;
+		stats_end("key_plainfile_read", phase_start, key_outgoing.piece_length - 7);
+		if(loaded == false)
+		{	key_release(key_outgoing);
+			secure_wipe(plainfile, sizeof(plainfile));
+			key_unreserve(state, true, position, position + 1);
+			cout << "\n\nKey file " << key_outgoing.name << " or plainfile could not be read.\n"
+			     << "(A key wiped in part is refused: remove keys.state and keys.reserve to skip it.)\n";
+			return 0;
 		}
 		
-		///Encrypts plainfile using the remaining 1,000,007 in plainfile[].
-		for(int a = 0; a < 1000007; a++)
-		{	temp_file_item_decimal  = plainfile[a          ];
-			temp_file_item_decimal += plainfile[a + 1000007];
-			temp_file_item_decimal %= 256;
-			plainfile[a] = temp_file_item_decimal;
-		}
+		///Writes the file size to the first 7 plainfile[] elements and encrypts plainfile using the key's second half (1,000,007 in a whole key.)
+		phase_start = stats_begin();
+		frame_encrypt(plainfile, key_outgoing.bytes, file_size_counter, class_size, compressed);
+		stats_end("encrypt", phase_start, class_size + 7);
 		
-		//Creating and writing to cipherfile. Converts from (0 - 255) to (-128 - 127.)
-		out_stream.open("cipherfile");
-		for(int a = 0; a < 1000007; a++)
-		{	if(plainfile[a] < 128) {out_stream.put(plainfile[a]      );}
-			else                   {out_stream.put(plainfile[a] - 256);}
+		//Creating and writing to cipherfile.
+		phase_start = stats_begin();
+		if(block_write_file("cipherfile", plainfile, class_size + 7) == false)
+		{	//Gives the key back unused, as it was never sent: both sides stay in step. What got written of cipherfile goes too.
+			remove("cipherfile");
+			key_release(key_outgoing);
+			secure_wipe(plainfile, sizeof(plainfile));
+			key_unreserve(state, true, position, position + 1);
+			cout << "\n\ncipherfile could not be written. The key is kept for the next file.\n";
+			return 0;
 		}
-		out_stream.close();
+		stats_end("cipherfile_write", phase_start, class_size + 7);
 		
-		//Overwrites the used key file twice with 2,000,014 characters each round, before removing it.
-		out_stream.open(file_name_key_outgoing); for(int a = 0; a < 2000014; a++) {out_stream << '\0';} out_stream.close(); //Binary: 00000000
-		out_stream.open(file_name_key_outgoing); for(int a = 0; a < 2000014; a++) {out_stream.put(-1);} out_stream.close(); //Binary: 11111111
-		
-		//Removes the used key.
-		remove(file_name_key_outgoing);
+		//Overwrites the used key file twice with 2,000,014 characters each round, before removing it. (Finishes below.)
+		//In a small size class, only the used piece--unless it's the key's last.
+		shred_report key_shred_report;
+		thread key_shredder;
+		if(piece == (pieces - 1)) {key_shredder = key_consume_async      (key_outgoing, &key_shred_report);}
+		else                      {key_shredder = key_consume_piece_async(key_outgoing, &key_shred_report);}
 		remove("plainfile"); //Removing the raw file prevents accidentally sending it. (User is asked to place a COPY here.)
 		
 		//Overwriting RAM of array plainfile[].
-		for(int a = 0; a < 2000014; a++)
-		{	plainfile[a] = 255; plainfile[a] = 0;
-		}
+		phase_start = stats_begin();
+		secure_wipe(plainfile, sizeof(plainfile));
+		stats_end("memory_wipe", phase_start, sizeof(plainfile));
 		
-		//Adjusts file remaining.encrypt.txt.
+		//Adjusts keys.state and file remaining.encrypt.txt.
+		phase_start = stats_begin();
+		bool committed = key_state_commit(state, true, position + 1, (piece == (pieces - 1)) ? 1 : 0, false);
+		stats_end("counter_commit", phase_start, 0);
 		remaining_encrypt_decimal--;
-		in_stream.open("swapped");
-		if(in_stream.fail() == true) {in_stream.close(); out_stream.open("remaining.encrypt.txt");}
-		else                         {in_stream.close(); out_stream.open("remaining.decrypt.txt");}
-		
-		if(remaining_encrypt_decimal < 100) {out_stream << "0";}
-		if(remaining_encrypt_decimal <  10) {out_stream << "0";}
-		out_stream << remaining_encrypt_decimal;
-		out_stream << " files left to encrypt. Do not modify this file. Digits must be 000 - 125";
-		out_stream.close();
 		
 		//Displays # of files left to encrypt.
 		cout << "\n\ncipherfile now resides in this directory.\n";
 		if     (remaining_encrypt_decimal == 0) {cout << "Encryption keys depleted.\n"     ;}
 		else if(remaining_encrypt_decimal == 1) {cout << "You may encrypt one more file.\n";}
 		else   {cout << "You may encrypt " << remaining_encrypt_decimal << " more files.\n";}
+		
+		key_shredder.join();
+		stats_shred(key_shred_report, key_outgoing.piece_length);
+		shred_print_report(key_shred_report);
+		cout << "Wall clock: " << ((int)(chrono::duration<double>(chrono::steady_clock::now() - run_start).count() * 10000) / 10.0) << "ms (" << io_backend_name() << ".)\n";
+		if(committed == false) {key_state_commit_warn(); return 1;}
 	}
 	
 	
@@ -245,24 +4315,13 @@ int main()
 	
 	//______________________________________________________Decrypt___________________________________________________//
 	if(user_option == 2)
-	{	ifstream in_stream;
-		ofstream out_stream;
-		
-		//Checks if files exist.
-		in_stream.open("swapped");
-		if(in_stream.fail() == true) {in_stream.close(); in_stream.open("remaining.decrypt.txt");}
-		else                         {in_stream.close(); in_stream.open("remaining.encrypt.txt");}
-		
-		if(in_stream.fail() == true) {cout << "\n\nCan't decrypt without keys.\n"; in_stream.close(); return 0;}
-		char remaining_decrypt[3];
-		for(int a = 0; a < 3; a++) {in_stream >> remaining_decrypt[a]; remaining_decrypt[a] -= 48;}
-		in_stream.close();
-		
-		int remaining_decrypt_decimal = 0;
-		if(remaining_decrypt[ 0] > 0) {remaining_decrypt_decimal += (remaining_decrypt[ 0] * 100);}
-		if(remaining_decrypt[ 1] > 0) {remaining_decrypt_decimal += (remaining_decrypt[ 1] *  10);}
-		if(remaining_decrypt[ 2] > 0) {remaining_decrypt_decimal += (remaining_decrypt[ 2]      );}
-		if(remaining_decrypt_decimal == 0)   {cout << "\n\nDecryption keys depleted, consider swapping channels.\n"; return 0;}
+	{	//Checks if keys exist (keys.state, or the files it is rebuilt from.)
+		key_state state;
+		if(key_state_load(state) == false) {cout << "\n\nCan't decrypt without keys.\n"; return 0;}
+		int remaining_decrypt_decimal = key_state_files_left(state, false); //Files, not keys: one key serves many in a small size class.
+		long long class_size = state.class_size;
+		int pieces = size_class_pieces(class_size);
+		if(remaining_decrypt_decimal ==  0) {cout << "\n\nDecryption keys depleted, consider swapping channels.\n"; return 0;}
 		
 		//Instructing user to give the file.
 		if(remaining_decrypt_decimal == 1)   {cout << "\nYou may decrypt one more file." ;}
@@ -272,120 +4331,98 @@ int main()
 		
 		char wait; cin >> wait; if(wait != 'y') {return 0;}
 		
-		//Maintaining symmetry entanglement.
-		char file_name_key_incoming[20] = "./keys/incoming/000";
-		in_stream.open("symmetry.entanglement");
-		if(in_stream.fail() == true)
-		{	file_name_key_incoming[ 7] = 'o';
-			file_name_key_incoming[ 8] = 'u';
-			file_name_key_incoming[ 9] = 't';
-			file_name_key_incoming[10] = 'g';
-			file_name_key_incoming[11] = 'o';
+		//Checks the file before taking a key for it.
+		long long cipherfile_size = block_file_size("cipherfile");
+		if(cipherfile_size ==      -1) {cout << "\n\ncipherfile not present.\n"                 ; return 0;}
+		if(cipherfile_size != (class_size + 7))
+		{	if(class_size == size_class_default) {cout << "\n\ncipherfile must be 1,000,007 bytes.\n"                       ; return 0;}
+			else                                 {cout << "\n\ncipherfile must be " << (class_size + 7) << " bytes.\n"; return 0;}
 		}
-		in_stream.close();
 		
-		//Generates key file NAME based on existence.
-		int file_numbering = 1000000; //Only the last 3 digits are used, size makes mod operations easier.
-		for(int a = 0; a < 125; a++)
-		{	in_stream.open(file_name_key_incoming);
-			if(in_stream.fail() == false) {in_stream.close(); break;}
-			
-			//Adjusts file numbering.
-			file_numbering++;
-			int temp_file_numbering = file_numbering;
-			file_name_key_incoming[18] = (temp_file_numbering % 10) + 48; //       ./keys/incoming/0  0  0    (file name)
-			temp_file_numbering /=    10; //                                                       ^  ^  ^
-			file_name_key_incoming[17] = (temp_file_numbering % 10) + 48; //                      16 17 18    (element layout)
-			temp_file_numbering /=    10;
-			file_name_key_incoming[16] = (temp_file_numbering % 10) + 48;
-		}
+		//Reserves the next key (or piece) in keys/incoming or keys/outgoing (symmetry entanglement.) No other process gets it.
+		chrono::steady_clock::time_point run_start = chrono::steady_clock::now(); //Wall clock from here to the key shredded.
+		key_slot key_incoming;
+		chrono::steady_clock::time_point phase_start = stats_begin();
+		long long position = key_reserve(state, false);
+		stats_end("key_reserve", phase_start, 0);
+		if(position == -1) {cout << "\n\nNo key files left in this folder.\n"; return 0;}
+		int key_number = (position / pieces);
+		int piece      = (position % pieces);
+		key_slot_set(key_incoming, key_state_outgoing(state, false), key_number, piece, class_size);
 		
-		//Gets key file for decryption.
+		//Gets key file for decryption (read into cipherfile[], or read in place from a key pack) and the file over its first half.
+		//Both reads at once (see Async I/O.)
 		unsigned char cipherfile[2000014];
-		char temp_file_item;
-		int  temp_file_item_decimal;
-		in_stream.open(file_name_key_incoming);
-		for(int a = 0; a < (2000014); a++)
-		{	in_stream.get(temp_file_item);
-			temp_file_item_decimal = temp_file_item;
-			if(temp_file_item_decimal < 0) {cipherfile[a] = (temp_file_item_decimal + 256);}
-			else                           {cipherfile[a] =  temp_file_item_decimal       ;}
+		phase_start = stats_begin();
+		bool loaded = key_load_with_input(key_incoming, cipherfile, cipherfile_size, "cipherfile", cipherfile, cipherfile_size);
+		stats_end("key_cipherfile_read", phase_start, key_incoming.piece_length);
+		if(loaded == false)
+		{	key_release(key_incoming);
+			secure_wipe(cipherfile, sizeof(cipherfile));
+			key_unreserve(state, false, position, position + 1);
+			cout << "\n\nKey file " << key_incoming.name << " or cipherfile could not be read.\n"
+			     << "(A key wiped in part is refused: remove keys.state and keys.reserve to skip it.)\n";
+			return 0;
 		}
-		in_stream.close();
 		
-		//Gets file items and overwrites first half of plainfile[].
-		in_stream.open("cipherfile");
-		if(in_stream.fail() == true) {in_stream.close(); cout << "\n\ncipherfile not present.\n"; return 0;}
-		for(int a = 0; a < 1000007; a++)
-		{	in_stream.get(temp_file_item);
-			temp_file_item_decimal = temp_file_item;
-			if(temp_file_item_decimal < 0) {temp_file_item_decimal += 256;}
-			cipherfile[a] = temp_file_item_decimal;
-		}
-		in_stream.close();
+		///Decrypts the cipherfile and extracts the file size from the first 7 elements in cipherfile[]. (See frame_decrypt().)
+		phase_start = stats_begin();
+		bool compressed;
+		long long extracted_file_size = frame_decrypt(cipherfile, key_incoming.bytes, class_size, &compressed);
+		stats_end("decrypt", phase_start, class_size + 7);
 		
-		///Decrypts the cipherfile. The following formula helps extract plaintext quickly.
-		/*_____________________________________________ ________________________________________________
-		|                                              |                                                |
-		|          if sub-key <= cipherfile            |                     else                       |
-		|   then plainfile = (cipherfile - sub-key)    |    plainfile = ((256 - sub-key) + cipherfile)  |
-		|______________________________________________|_______________________________________________*/
-		for(int a = 0; a < 1000007; a++)
-		{	if(cipherfile[a + 1000007] <= cipherfile[a])
-			{	cipherfile[a] = (cipherfile[a] - cipherfile[a + 1000007]);
-			}
-			else
-			{	cipherfile[a] = ((256 - cipherfile[a + 1000007]) + cipherfile[a]);
-			}
+		//Expands the file if it was packed (see Compression.)
+		vector<unsigned char> expanded_file;
+		const unsigned char* extracted_file = (cipherfile + 7);
+		if(compressed == true)
+		{	phase_start = stats_begin();
+			if(compress_expand_file(cipherfile + 7, extracted_file_size, expanded_file) == true) {extracted_file = expanded_file.data(); extracted_file_size = expanded_file.size();}
+			stats_end("expand", phase_start, extracted_file_size);
 		}
 		
-		//Extracts the file size from the first 7 elements in cipherfile[].
-		int extracted_file_size = 0;
-		if(cipherfile[0] > 0) {extracted_file_size += (cipherfile[0] * 1000000);}
-		if(cipherfile[1] > 0) {extracted_file_size += (cipherfile[1] *  100000);}
-		if(cipherfile[2] > 0) {extracted_file_size += (cipherfile[2] *   10000);}
-		if(cipherfile[3] > 0) {extracted_file_size += (cipherfile[3] *    1000);}
-		if(cipherfile[4] > 0) {extracted_file_size += (cipherfile[4] *     100);}
-		if(cipherfile[5] > 0) {extracted_file_size += (cipherfile[5] *      10);}
-		if(cipherfile[6] > 0) {extracted_file_size +=  cipherfile[6]           ;}
-		
-		//Creating and writing to plainfile. Converts from (0 - 255) to (-128 - 127.)
-		out_stream.open("plainfile");
-		for(int a = 7; a < extracted_file_size + 7; a++)
-		{	if(cipherfile[a] < 128) {out_stream.put(cipherfile[a]      );}
-			else                    {out_stream.put(cipherfile[a] - 256);}
+		//Creating and writing to plainfile.
+		phase_start = stats_begin();
+		bool written = block_write_file("plainfile", extracted_file, extracted_file_size);
+		secure_wipe(expanded_file.data(), expanded_file.size());
+		if(written == false)
+		{	//Gives the key back unused, so cipherfile can be decrypted again once there is room.
+			remove("plainfile");
+			key_release(key_incoming);
+			secure_wipe(cipherfile, sizeof(cipherfile));
+			key_unreserve(state, false, position, position + 1);
+			cout << "\n\nplainfile could not be written. The key is kept: try again.\n";
+			return 0;
 		}
-		out_stream.close();
-		
-		//Overwrites the used key file twice with 2,000,014 characters each round, before removing it.
-		out_stream.open(file_name_key_incoming); for(int a = 0; a < 2000014; a++) {out_stream << '\0';} out_stream.close(); //Binary: 00000000
-		out_stream.open(file_name_key_incoming); for(int a = 0; a < 2000014; a++) {out_stream.put(-1);} out_stream.close(); //Binary: 11111111
+		stats_end("plainfile_write", phase_start, extracted_file_size);
 		
-		//Removes the used key.
-		remove(file_name_key_incoming);
+		//Overwrites the used key file twice with 2,000,014 characters each round, before removing it. (Finishes below.)
+		shred_report key_shred_report;
+		thread key_shredder;
+		if(piece == (pieces - 1)) {key_shredder = key_consume_async      (key_incoming, &key_shred_report);}
+		else                      {key_shredder = key_consume_piece_async(key_incoming, &key_shred_report);}
 		
 		//Overwriting RAM of array cipherfile[].
-		for(int a = 0; a < 2000014; a++)
-		{	cipherfile[a] = 255; cipherfile[a] = 0;
-		}
+		phase_start = stats_begin();
+		secure_wipe(cipherfile, sizeof(cipherfile));
+		stats_end("memory_wipe", phase_start, sizeof(cipherfile));
 		
-		//Adjusts file remaining.decrypt.txt.
+		//Adjusts keys.state and file remaining.decrypt.txt.
+		phase_start = stats_begin();
+		bool committed = key_state_commit(state, false, position + 1, (piece == (pieces - 1)) ? 1 : 0, false);
+		stats_end("counter_commit", phase_start, 0);
 		remaining_decrypt_decimal--;
-		in_stream.open("swapped");
-		if(in_stream.fail() == true) {in_stream.close(); out_stream.open("remaining.decrypt.txt");}
-		else                         {in_stream.close(); out_stream.open("remaining.encrypt.txt");}
-		
-		if(remaining_decrypt_decimal < 100) {out_stream << "0";}
-		if(remaining_decrypt_decimal <  10) {out_stream << "0";}
-		out_stream << remaining_decrypt_decimal;
-		out_stream << " files left to decrypt. Do not modify this file. Digits must be 000 - 125";
-		out_stream.close();
 		
 		//Displays # of files left to decrypt .
 		cout << "\n\nplainfile now resides in this directory.\n";
 		if     (remaining_decrypt_decimal == 0) {cout << "Decryption keys depleted.\n"     ;}
 		else if(remaining_decrypt_decimal == 1) {cout << "You may decrypt one more file.\n";}
 		else   {cout << "You may decrypt " << remaining_decrypt_decimal << " more files.\n";}
+		
+		key_shredder.join();
+		stats_shred(key_shred_report, key_incoming.piece_length);
+		shred_print_report(key_shred_report);
+		cout << "Wall clock: " << ((int)(chrono::duration<double>(chrono::steady_clock::now() - run_start).count() * 10000) / 10.0) << "ms (" << io_backend_name() << ".)\n";
+		if(committed == false) {key_state_commit_warn(); return 1;}
 	}
 	
 	
@@ -402,154 +4439,173 @@ int main()
 		if(in_stream.fail() == false) {cout << "\n\nKeys already exist, run a new schemeOTP.cpp file in a different folder.\n"; return 0;}
 		in_stream.close();
 		
-		//Gets seeds for RNG.
-		cout << "\nEnter a random nine-digit integer, repeat 90 times. (Get 500MB of keys in 15m.)\n\n";
-		unsigned int user_seeds[90] = {0};
-		for(int a = 0; a < 90; a++)
-		{	if(a < 9) {cout << " " << (a + 1) << " of 90: ";} //Prints blank to align input status report (aesthetics.)
-			else      {cout <<        (a + 1) << " of 90: ";}
+		//Offers to go on with an interrupted run (see Streaming keygen), or gets the choices and seeds anew.
+		keygen_checkpoint checkpoint;
+		memset(&checkpoint, 0, sizeof(checkpoint));
+		bool resuming = false;
+		if(keygen_checkpoint_read(checkpoint) == true)
+		{	cout << "\nKey generation here stopped after " << checkpoint.keys_done << " of 250 keys. Go on from there (no seeds needed)? y/n: ";
+			char wait; cin >> wait;
+			resuming = (wait == 'y');
+			if(resuming == false) {keygen_checkpoint_remove(); memset(&checkpoint, 0, sizeof(checkpoint));}
+		}
+		int          keygen_version    = checkpoint.keygen_version;
+		bool         packed            = (checkpoint.packed == 1);
+		int          size_class_option = checkpoint.size_class_option;
+		unsigned int user_seeds[90];
+		memcpy(user_seeds, checkpoint.user_seeds, sizeof(user_seeds));
+		long long class_sizes[3] = {1000000, 65536, 4096};
+		if(resuming == false)
+		{	//Gets keygen version.
+			cout << "\n(2) Keygen v2.2 (same keys as version 2.2 from the same seeds.)"
+			     << "\n(3) Keygen v3   (keys differ from v2.2 even with the same seeds.)"
+			     << "\n\nEnter keygen version: ";
+			cin >> keygen_version;
+			if((keygen_version != 2) && (keygen_version != 3)) {cout << "\nInvalid, program ended.\n"; return 0;}
+			
+			//Gets key store format.
+			cout << "\n(1) Key files (250 files in keys/incoming and keys/outgoing, as in v2.2.)"
+			     << "\n(2) Key packs (2 files, keys/incoming.pack and keys/outgoing.pack.)"
+			     << "\n\nEnter key store format: ";
+			int key_store_format;
+			cin >> key_store_format;
+			if((key_store_format != 1) && (key_store_format != 2)) {cout << "\nInvalid, program ended.\n"; return 0;}
+			packed = (key_store_format == 2);
+			
+			//Gets size class.
+			cout << "\n(1) 1,000,000 bytes per file at most, 1 file per key (as in v2.2.)"
+			     << "\n(2)    65,536 bytes per file at most, 15 files per key."
+			     << "\n(3)     4,096 bytes per file at most, 243 files per key."
+			     << "\n\nEnter size class: ";
+			cin >> size_class_option;
+			if((size_class_option < 1) || (size_class_option > 3)) {cout << "\nInvalid, program ended.\n"; return 0;}
 			
-			//Gets and checks input.
-			cin >> user_seeds[a];
-			if((user_seeds[a] > 999999999) || (user_seeds[a] < 100000000)) {cout << "\nOut of bounds, try again.\n"; return 0;}
+			//Gets seeds for RNG.
+			if(keygen_version == 2) {cout << "\nEnter a random nine-digit integer, repeat 90 times. (Get 500MB of keys in 15m.)\n\n";}
+			else                    {cout << "\nEnter a random nine-digit integer, repeat 90 times. (Get 500MB of keys.)\n\n"        ;}
+			for(int a = 0; a < 90; a++)
+			{	if(a < 9) {cout << " " << (a + 1) << " of 90: ";} //Prints blank to align input status report (aesthetics.)
+				else      {cout <<        (a + 1) << " of 90: ";}
+				
+				//Gets and checks input.
+				cin >> user_seeds[a];
+				if((user_seeds[a] > 999999999) || (user_seeds[a] < 100000000)) {cout << "\nOut of bounds, try again.\n"; return 0;}
+			}
 		}
 		
-		cout << "\nWait 15 minutes...\n";
-		
-		//Fills table_private[] with randomness 0 - 255 (later converted to (-128 - 127) upon writing to files.)
-		static unsigned char table_private[501000000] = {0};
-		int temp_modular_arithmetic;
-		for(int a = 0; a < 90; a++) //Constructively applies random digits to table_private[] based on the 90 seeds provided by the user.
-		{	srand(user_seeds[a]);   //WRITES ALTERNATING BETWEEN LEFT TO RIGHT & RIGHT TO LEFT. Alternation is based on the 90 user seeds.
-			
-			if((user_seeds[a] % 2) == 0)
-			{	for(int b = 0; b < 501000000; b++) //WRITES LEFT TO RIGHT.
-				{	temp_modular_arithmetic = table_private[b];
-					temp_modular_arithmetic += (rand() % 256);
-					temp_modular_arithmetic %= 256;
-					table_private[b] = temp_modular_arithmetic;
-				}
+		//Generates and writes all 250 keys, keygen_memory_cap bytes of them in RAM at most.
+		int thread_count = thread::hardware_concurrency();
+		if(thread_count < 1) {thread_count = 1;}
+		mkdir("keys"           ,  0777); //Creates a folder.
+		if((packed == true) && (resuming == false))
+		{	if((key_pack_create(false) == false) || (key_pack_create(true) == false)) {cout << "\n\nKey packs could not be made (500MB of disk space needed.)\n"; return 1;}
+		}
+		else if(packed == false)
+		{	mkdir("./keys/incoming",  0777); //Creates a folder within that keys folder.
+			mkdir("./keys/outgoing",  0777); //Creates another folder within that keys folder.
+		}
+		if(resuming == false)
+		{	if(keygen_version == 3)
+			{	cout << "\nWorking on " << thread_count << " threads...\n";
+				checkpoint.engine = 3;
+			}
+			else if(keygen_v2_parallel_matches_serial(user_seeds) == true)
+			{	cout << "\nWorking on " << thread_count << " threads (v2.2 self-check passed)...\n";
+				checkpoint.engine = 2;
 			}
 			else
-			{	for(int b = 500999999; b >= 0; b--) //WRITES RIGHT TO LEFT.
-				{	temp_modular_arithmetic = table_private[b];
-					temp_modular_arithmetic += (rand() % 256);
-					temp_modular_arithmetic %= 256;
-					table_private[b] = temp_modular_arithmetic;
-				}
+			{	cout << "\nThis C library's rand() is not the one v2.2 was modeled on, using one thread and 1GB RAM. Wait 15 minutes...\n";
+				checkpoint.engine = 0;
 			}
+			
+			//Saves the choices and seeds before any key is written, so that a stop from here on is resumable.
+			memcpy(checkpoint.magic, "OTPkgck1", 8);
+			checkpoint.keygen_version    = keygen_version;
+			checkpoint.packed            = packed;
+			checkpoint.size_class_option = size_class_option;
+			memcpy(checkpoint.user_seeds, user_seeds, sizeof(user_seeds));
+			checkpoint.keys_done         = 0;
+			if(keygen_checkpoint_save(checkpoint) == false) {cout << "\n\nCould not write keygen.checkpoint, program ended.\n"; return 1;}
 		}
+		else {cout << "\nGoing on from key " << (checkpoint.keys_done + 1) << " on " << thread_count << " threads...\n";}
+		chrono::steady_clock::time_point phase_start = stats_begin();
+		keygen_health health = {false, 0, 0, "", 0, 0};
+		bool keys_made = keygen_stream_keys(checkpoint.engine, user_seeds, thread_count, packed, checkpoint, health);
+		stats_end("keygen", phase_start, (250 * 2000014LL));
 		
-		//Adding additional randomness in table_private[].
-		unsigned int seeds_sum = 0;
-		for(int a = 0; a < 90; a++)
-		{	seeds_sum += user_seeds[a];
-			seeds_sum %= 1000000000;
-		}
-		srand(seeds_sum); //A new 9-digit seed comes from the sum of ALL user-seeds.
-		for(int a = 0; a < 501000000; a++) //WRITES LEFT TO RIGHT.
-		{	temp_modular_arithmetic = table_private[a];
-			temp_modular_arithmetic += (rand() % 256);
-			temp_modular_arithmetic %= 256;
-			table_private[a] = temp_modular_arithmetic;
+		//Keys could not be written: no counters or keys.state, and the checkpoint still stands before them.
+		if((keys_made == false) && (health.failed == false))
+		{	cout << "\n\nKeys could not be written (disk full?) No counters or keys.state were made. Free some space and run\n"
+			     << "option 3 again: it goes on from key " << (checkpoint.keys_done + 1) << ".\n";
+			secure_wipe(user_seeds, sizeof(user_seeds));
+			secure_wipe(&checkpoint, sizeof(checkpoint));
+			return 1;
 		}
 		
-		//Again, adding additional randomness in table_private[].
-		seeds_sum = 0;
-		for(int a = 0; a < 90; a += 2)
-		{	seeds_sum += user_seeds[a];
-			seeds_sum %= 1000000000;
-		}
-		srand(seeds_sum); //Another new 9-digit seed comes from the sum of EVERY OTHER user-seed.
-		for(int a = 500999999; a >= 0; a--) //WRITES RIGHT TO LEFT.
-		{	temp_modular_arithmetic = table_private[a];
-			temp_modular_arithmetic += (rand() % 256);
-			temp_modular_arithmetic %= 256;
-			table_private[a] = temp_modular_arithmetic;
+		//A key failed a health test: no counters or keys.state, so nothing here gets used.
+		if(keys_made == false)
+		{	health_report(health);
+			secure_wipe(user_seeds, sizeof(user_seeds));
+			secure_wipe(&checkpoint, sizeof(checkpoint));
+			keygen_checkpoint_remove();
+			return 0;
 		}
-		
-		//Creates initial file names in folders.
-		mkdir("keys"           ,  0777); //Creates a folder.
-		mkdir("./keys/incoming",  0777); //Creates a folder within that keys folder.
-		mkdir("./keys/outgoing",  0777); //Creates another folder within that keys folder.
-		char file_name_key_incoming[20] = "./keys/incoming/000";
-		char file_name_key_outgoing[20] = "./keys/outgoing/000";
-		
-		//Writes 125 keys to folder incoming. Converts from (0 - 255) to values (-128 - 127.)
-		int file_numbering = 1000000; //Only the last 3 digits are used, size makes mod operations easier.
-		int write_bookmark = 0;
-		for(int i = 0; i < 125; i++)
-		{	out_stream.open(file_name_key_incoming);
-			for(int a = 0; a < 2000014; a++)
-			{	if(table_private[write_bookmark] < 128) {out_stream.put(table_private[write_bookmark]      );}
-				else                                    {out_stream.put(table_private[write_bookmark] - 256);}
-				
-				write_bookmark++;
-			}
-			out_stream.close();
-			
-			//Adjusts file numbering.
-			file_numbering++;
-			int temp_file_numbering = file_numbering;
-			file_name_key_incoming[18] = (temp_file_numbering % 10) + 48; //       ./keys/incoming/0  0  0    (file name)
-			temp_file_numbering /=    10; //                                                       ^  ^  ^
-			file_name_key_incoming[17] = (temp_file_numbering % 10) + 48; //                      16 17 18    (element layout)
-			temp_file_numbering /=    10;
-			file_name_key_incoming[16] = (temp_file_numbering % 10) + 48;
-		}
-		
-		//Writes 125 keys to folder outgoing. Converts from (0 - 255) to values (-128 - 127.)
-		file_numbering = 1000000; //Resetting.
-		for(int i = 0; i < 125; i++)
-		{	out_stream.open(file_name_key_outgoing);
-			for(int a = 0; a < 2000014; a++)
-			{	if(table_private[write_bookmark] < 128) {out_stream.put(table_private[write_bookmark]      );}
-				else                                    {out_stream.put(table_private[write_bookmark] - 256);}
-				
-				write_bookmark++;
-			}
-			out_stream.close();
-			
-			//Adjusts file numbering.
-			file_numbering++;
-			int temp_file_numbering = file_numbering;
-			file_name_key_outgoing[18] = (temp_file_numbering % 10) + 48; //       ./keys/outgoing/0  0  0    (file name)
-			temp_file_numbering /=    10; //                                                       ^  ^  ^
-			file_name_key_outgoing[17] = (temp_file_numbering % 10) + 48; //                      16 17 18    (element layout)
-			temp_file_numbering /=    10;
-			file_name_key_outgoing[16] = (temp_file_numbering % 10) + 48;
+		if(health.keys_failed > 0) {health_report(health);}
+		else
+		{	cout << "Health tests passed on all 250 keys.\n";
+			remove("keygen.health");
 		}
 		
 		//Creates the encryption remaining counter file.
+		bool written = true;
 		out_stream.open("remaining.encrypt.txt");
 		out_stream << "125 files left to encrypt. Do not modify this file. Digits must be 000 - 125";
 		out_stream.close();
+		if(out_stream.fail() == true) {written = false;}
 		
 		//Creates the decryption remaining counter file.
 		out_stream.open("remaining.decrypt.txt");
 		out_stream << "125 files left to decrypt. Do not modify this file. Digits must be 000 - 125";
 		out_stream.close();
+		if(out_stream.fail() == true) {written = false;}
 		
 		//Creates the symmetry entanglement file.
 		out_stream.open("symmetry.entanglement");
 		out_stream << "REMINDER: one of you must remove this file!\n"
 		           << "(Key maker had already been asked to do so.)";
 		out_stream.close();
+		if(out_stream.fail() == true) {written = false;}
 		
-		//Overwrites RAM of user_seeds[].
-		for(int a = 0; a < 90; a++)
-		{	user_seeds[a] = 123456789;
-			user_seeds[a] = 987604321;
-			user_seeds[a] = 0;
-		}
+		//Creates the size class file, then keys.state (replacing any from old keys here, and their keys.reserve and keys.digest.)
+		if(size_class_write(class_sizes[size_class_option - 1]) == false) {written = false;}
+		phase_start = stats_begin();
+		key_state state;
+		key_state_new(state);
+		if(key_state_save(state) == false) {written = false;}
+		remove("keys.reserve");
+		remove("keys.digest");
+		stats_end("state_write", phase_start, sizeof(state));
 		
-		//Overwrites RAM of array table_private[].
-		for(int a = 0; a < 501000000; a++)
-		{	for(int b = 0; b < 10; b++) {table_private[a] = b;}
+		//The keys are there, but not what uses them: the checkpoint stays, so option 3 again writes these once more.
+		if(written == false)
+		{	remove("remaining.encrypt.txt");
+			remove("remaining.decrypt.txt");
+			remove("keys.state");
+			cout << "\n\nCounters, size.class or keys.state could not be written (disk full?) Free some space and run\n"
+			     << "option 3 again to finish.\n";
+			secure_wipe(user_seeds, sizeof(user_seeds));
+			secure_wipe(&checkpoint, sizeof(checkpoint));
+			return 1;
 		}
 		
+		//Overwrites RAM of user_seeds[] and the checkpoint, then shreds keygen.checkpoint (it holds the seeds.)
+		secure_wipe(user_seeds, sizeof(user_seeds));
+		secure_wipe(&checkpoint, sizeof(checkpoint));
+		keygen_checkpoint_remove();
+		
 		cout << "\n\nFinished! Share this folder in private, then\n"
-		     << "REMOVE file symmetry.entanglement on your end ONLY!\n\n";
+		     << "REMOVE file symmetry.entanglement on your end ONLY!\n"
+		     << "(Or run schemeOTP --export=FILE here and --import=FILE there: it does both.)\n\n";
 	}
 	
 	
@@ -559,7 +4615,6 @@ int main()
 	//______________________________________________________Swap_channels_____________________________________________//
 	if(user_option == 4)
 	{	ifstream in_stream;
-		ofstream out_stream;
 		
 		//Checks if files exist.
 		in_stream.open("remaining.encrypt.txt");
@@ -578,29 +4633,32 @@ int main()
 			return 0;
 		}
 		
-		//Creates file swapped if non-existent, removes it otherwise. This is pure SYMMETRY rather than entanglement.
-		in_stream.open("swapped");
-		if(in_stream.fail() == true)
-		{	out_stream.open("swapped");
-			out_stream << 1;
-			out_stream.close();
-			cout << "\n\nSymmetry entanglement reconfigured!\n";
-		}
-		else
-		{	remove("swapped");
-			cout << "\n\nChannel ownership restored.\n";
-		}
-		in_stream.close();
-		
-		//Creates file symmetry.entanglement if non-existent, removes it otherwise. This is pure ENTANGLEMENT rather than symmetry.
-		in_stream.open("symmetry.entanglement");
-		if(in_stream.fail() == true)
-		{	out_stream.open("symmetry.entanglement");
-			out_stream << "REMINDER: one of you must remove this file!\n"
-			           << "(Key maker had already been asked to do so.)";
-			out_stream.close();
-		}
-		else {remove("symmetry.entanglement");}
-		in_stream.close();
+		//Toggles files swapped and symmetry.entanglement, and records both in keys.state (see swap_channels_here().)
+		if(swap_channels_here() == true) {cout << "\n\nSymmetry entanglement reconfigured!\n";}
+		else                            {cout << "\n\nChannel ownership restored.\n"      ;}
 	}
+	
+	
+	
+	
+	
+	//______________________________________________________Batch_____________________________________________________//
+	if(user_option == 5) {return batch_run( true);}
+	if(user_option == 6) {return batch_run(false);}
+	
+	
+	
+	
+	
+	//______________________________________________________Large_file________________________________________________//
+	if(user_option == 7) {return stream_run( true);}
+	if(user_option == 8) {return stream_run(false);}
+	
+	
+	
+	
+	
+	//______________________________________________________Symmetry_digest___________________________________________//
+	if(user_option == 9) {digest_run();}
 }
+#endif
@@ -0,0 +1,71 @@
+/// schemeOTP library - encrypt and decrypt buffers with a schemeOTP keys folder.
+/// Nikolay Valentinovich Repnitskiy - License: WTFPLv2+ (wtfpl.net)
+
+
+/* Build schemeOTP.cpp with  g++ -O2 -pthread -DSCHEMEOTP_LIBRARY -c schemeOTP.cpp
+(or  make lib  for libschemeOTP.a) and link it into the program that includes
+this file. See Library in schemeOTP.cpp. A store is one keys folder (made by
+option 3, or imported), and any number may be open at once. Each reserved key
+is used for one encrypt or one decrypt, then consumed (shredded, counters
+committed) or released (given back.) Both sides use the same size class, so
+cipherfiles are all the same. */
+#ifndef SCHEMEOTP_H
+#define SCHEMEOTP_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+struct otp_store; //One keys folder.
+struct otp_key;   //One reserved key (or key piece.)
+
+//Opens the keys folder at folder. Returns 0 if there are no keys there.
+struct otp_store* otp_store_open(const char folder[]);
+
+//Registers peer (1 - 47 letters, digits, '.', '-' or '_') in channels.registry at folder and makes folder peers/<ID> there
+//for its keys. Returns false if the ID is not valid or the registry can't take it.
+bool otp_peer_add(const char folder[], const char peer[]);
+
+//Opens the keys folder of a registered peer (peers/<ID> in folder), keeping its record in channels.registry up to date.
+//Returns 0 if peer is not registered or has no keys.
+struct otp_store* otp_store_open_peer(const char folder[], const char peer[]);
+
+//Closes a store. Keys still reserved from it stay skipped.
+void otp_store_close(struct otp_store* store);
+
+//Gets the files left to encrypt (or decrypt) with this store.
+int otp_files_left(struct otp_store* store, bool encrypting);
+
+//Gets the bytes of every cipherfile, and the most a file may have (unless compressed.)
+long long otp_cipherfile_length(const struct otp_store* store);
+long long otp_file_length_max  (const struct otp_store* store);
+
+//Reserves and loads the next key to encrypt or decrypt with. Returns 0 if none is left or it can't be read.
+struct otp_key* otp_reserve(struct otp_store* store, bool encrypting);
+
+//Gets the key's place in its folder. The other side reserves keys in the same order: label cipherfiles with it.
+long long otp_key_position(const struct otp_key* key);
+
+//Encrypts length bytes of file[] to cipherfile[] (otp_cipherfile_length() bytes.) Compress: packs the file first, kept if
+//smaller. Returns the cipherfile length, or -1 if the file doesn't fit.
+long long otp_encrypt_buffer(const struct otp_store* store, const struct otp_key* key, const unsigned char file[], long long length, unsigned char cipherfile[], bool compress);
+
+//Decrypts cipherfile[] (otp_cipherfile_length() bytes) to file[] (capacity bytes.) Returns the file length, or -1 if it's not
+//a cipherfile or file[] is too small.
+long long otp_decrypt_buffer(const struct otp_store* store, const struct otp_key* key, const unsigned char cipherfile[], long long length, unsigned char file[], long long capacity);
+
+//Shreds a used key, commits it and frees key. Returns false if shredding or the commit failed (the key is used anyway.)
+bool otp_consume(struct otp_store* store, struct otp_key* key);
+
+//Gives back an unused key and frees key. Returns false if another process reserved past it meanwhile (it is then skipped.)
+bool otp_release(struct otp_store* store, struct otp_key* key);
+
+//Swaps channels on this end (as option 4.) Returns true if channels are now swapped. The other end must do the same.
+bool otp_swap_channels(struct otp_store* store);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
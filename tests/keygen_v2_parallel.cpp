@@ -0,0 +1,65 @@
+/// Keygen v2.2: the jump-ahead engine against the serial one it must match byte for byte.
+/// Built and run with the others by  make test  in the repository folder, or:
+///   g++ -O2 -pthread -DSCHEMEOTP_LIBRARY -c schemeOTP.cpp
+///   g++ -O2 -pthread -o keygen_v2_parallel tests/keygen_v2_parallel.cpp schemeOTP.o
+///   ./keygen_v2_parallel        (prints "passed", exit 0, or what failed, exit 1.)
+///
+/// Small tables of odd and even sizes, made whole and in windows of odd lengths
+/// (as option 3 streams them), on 1 to 16 threads, so that slices start and end
+/// mid-word, mid-block and at the table's ends, and some threads get no bytes at
+/// all. Seeds are fixed, some odd (right to left) and some even. Needs glibc's
+/// rand(), as v2.2 does: elsewhere option 3 uses the serial engine instead.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+using namespace std;
+
+//Not part of schemeOTP.h: declared here as in schemeOTP.cpp (see Keygen v2.2.)
+void keygen_v2_serial(unsigned char table[], int table_size, const unsigned int user_seeds[90], bool show_progress);
+void keygen_v2_parallel(unsigned char window[], long long window_start, long long window_length, long long table_size, const unsigned int user_seeds[90], int thread_count);
+
+int failures = 0;
+
+//Makes table_size bytes window by window (window_length each, the last one shorter) and compares with serial[].
+void check(const vector<unsigned char>& serial, const unsigned int seeds[90], long long window_length, int thread_count)
+{	long long table_size = serial.size();
+	vector<unsigned char> parallel(table_size, 0);
+	for(long long window_start = 0; window_start < table_size; window_start += window_length)
+	{	long long length = window_length;
+		if((window_start + length) > table_size) {length = (table_size - window_start);}
+		keygen_v2_parallel(parallel.data() + window_start, window_start, length, table_size, seeds, thread_count);
+	}
+	if(parallel != serial)
+	{	long long a = 0;
+		while(parallel[a] == serial[a]) {a++;}
+		printf("FAILED: table %lld, windows of %lld, %d threads: first differs at byte %lld\n", table_size, window_length, thread_count, a);
+		failures++;
+	}
+}
+
+int main()
+{	mt19937 random(2024);
+	const long long table_sizes[] = {1, 2, 7, 31, 4096, 4097, 65535, 100003};
+	const int thread_counts[] = {1, 2, 3, 5, 8, 16};
+	unsigned int seeds[90];
+	int tables = 0;
+	for(int seed_set = 0; seed_set < 2; seed_set++)
+	{	for(int a = 0; a < 90; a++) {seeds[a] = (100000000 + (random() % 900000000));}
+		if(seed_set == 1) {for(int a = 0; a < 90; a++) {seeds[a] |= 1;}} //Every pass right to left (bar the last two.)
+		for(long long table_size : table_sizes)
+		{	vector<unsigned char> serial(table_size, 0);
+			keygen_v2_serial(serial.data(), table_size, seeds, false);
+			tables++;
+			for(int thread_count : thread_counts)
+			{	check(serial, seeds, table_size, thread_count);                //One window.
+				check(serial, seeds, (table_size / 3) + 1, thread_count);      //Three windows, odd edges.
+				if(table_size > 50000) {check(serial, seeds, 9973, thread_count);} //Many windows, each a prime length.
+			}
+		}
+	}
+	if(failures > 0) {return 1;}
+	printf("passed (%d tables, %zu thread counts)\n", tables, sizeof(thread_counts) / sizeof(thread_counts[0]));
+	return 0;
+}
@@ -0,0 +1,135 @@
+/// Two channels in one process, through the library (schemeOTP.h.)
+/// Built and run with the others by  make test  in the repository folder, or:
+///   g++ -O2 -pthread -DSCHEMEOTP_LIBRARY -c schemeOTP.cpp
+///   g++ -O2 -pthread -o library_two_channels tests/library_two_channels.cpp schemeOTP.o
+///   ./library_two_channels        (prints "passed", exit 0, or what failed, exit 1.)
+///
+/// Alice registers peers bob and carol in one folder and opens both channels
+/// at once. Bob and Carol each open their own end. Messages go both ways on
+/// both channels, one after another and then from two threads at once. Each
+/// must decrypt, each channel must count its own keys, and the process's
+/// current directory must be where it was.
+
+#include "../schemeOTP.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+const int keys_per_way = 3; //Per folder (incoming, outgoing.)
+
+int failures = 0;
+
+void check(bool passed, const string& what)
+{	if(passed == false) {printf("FAILED: %s\n", what.c_str()); failures++;}
+}
+
+//Writes keys_per_way random keys to keys/incoming and keys/outgoing of both ends (the same keys), and the counters.
+//The maker's end keeps symmetry.entanglement.
+void make_channel(const string& maker, const string& other, unsigned int seed)
+{	mt19937 random(seed);
+	vector<char> key(2000014);
+	const string ends[2] = {maker, other};
+	for(int end = 0; end < 2; end++)
+	{	mkdir(ends[end].c_str(), 0777);
+		mkdir((ends[end] + "/keys").c_str(), 0777);
+		mkdir((ends[end] + "/keys/incoming").c_str(), 0777);
+		mkdir((ends[end] + "/keys/outgoing").c_str(), 0777);
+		ofstream(ends[end] + "/remaining.encrypt.txt") << "00" << keys_per_way << " files left to encrypt.";
+		ofstream(ends[end] + "/remaining.decrypt.txt") << "00" << keys_per_way << " files left to decrypt.";
+	}
+	ofstream(maker + "/symmetry.entanglement") << "Maker's end.";
+	for(int folder = 0; folder < 2; folder++)
+	{	for(int number = 0; number < keys_per_way; number++)
+		{	for(unsigned int a = 0; a < key.size(); a++) {key[a] = (char)random();}
+			string name = string("/keys/") + ((folder == 0) ? "incoming/00" : "outgoing/00") + to_string(number);
+			for(int end = 0; end < 2; end++) {ofstream(ends[end] + name, ios::binary).write(key.data(), key.size());}
+		}
+	}
+}
+
+//Encrypts a message on from and decrypts it on to. Returns false if anything fails or differs.
+bool send(otp_store* from, otp_store* to, unsigned int seed)
+{	mt19937 random(seed);
+	vector<unsigned char> message(1 + (random() % 5000)), cipherfile(otp_cipherfile_length(from)), file(otp_file_length_max(to));
+	for(unsigned int a = 0; a < message.size(); a++) {message[a] = random();}
+	
+	otp_key* key = otp_reserve(from, true);
+	if(key == 0) {return false;}
+	long long length = otp_encrypt_buffer(from, key, message.data(), message.size(), cipherfile.data(), false);
+	otp_consume(from, key);
+	if(length != (long long)cipherfile.size()) {return false;}
+	
+	key = otp_reserve(to, false);
+	if(key == 0) {return false;}
+	long long file_length = otp_decrypt_buffer(to, key, cipherfile.data(), cipherfile.size(), file.data(), file.size());
+	otp_consume(to, key);
+	return ((file_length == (long long)message.size()) && (memcmp(file.data(), message.data(), message.size()) == 0));
+}
+
+int main()
+{	char root[] = "/tmp/schemeOTP-test-XXXXXX";
+	if(mkdtemp(root) == 0) {printf("FAILED: no temporary folder\n"); return 1;}
+	string alice = string(root) + "/alice", bob = string(root) + "/bob", carol = string(root) + "/carol";
+	char start_folder[4096];
+	if(getcwd(start_folder, sizeof(start_folder)) == 0) {return 1;}
+	
+	//Alice's folder holds both channels, as schemeOTP --add-peer=bob and --add-peer=carol would make it.
+	mkdir(alice.c_str(), 0777);
+	check(otp_peer_add(alice.c_str(), "bob"  ) == true, "add peer bob");
+	check(otp_peer_add(alice.c_str(), "carol") == true, "add peer carol");
+	check(otp_peer_add(alice.c_str(), "../x" ) == false, "refuse peer ../x");
+	make_channel(alice + "/peers/bob"  , bob  , 1);
+	make_channel(alice + "/peers/carol", carol, 2);
+	
+	otp_store* alice_bob   = otp_store_open_peer(alice.c_str(), "bob"  );
+	otp_store* alice_carol = otp_store_open_peer(alice.c_str(), "carol");
+	otp_store* bob_end     = otp_store_open(bob.c_str()  );
+	otp_store* carol_end   = otp_store_open(carol.c_str());
+	check(otp_store_open_peer(alice.c_str(), "dave") == 0, "no store for unregistered peer dave");
+	if((alice_bob == 0) || (alice_carol == 0) || (bob_end == 0) || (carol_end == 0)) {printf("FAILED: stores did not open\n"); return 1;}
+	
+	//One after another, both ways on both channels, interleaved.
+	check(send(alice_bob  , bob_end    , 10), "alice to bob"  );
+	check(send(alice_carol, carol_end  , 11), "alice to carol");
+	check(send(bob_end    , alice_bob  , 12), "bob to alice"  );
+	check(send(carol_end  , alice_carol, 13), "carol to alice");
+	
+	//Both channels at once, from two threads.
+	bool passed[2] = {false, false};
+	thread to_bob  ([&]() {passed[0] = send(alice_bob  , bob_end  , 20);});
+	thread to_carol([&]() {passed[1] = send(alice_carol, carol_end, 21);});
+	to_bob.join();
+	to_carol.join();
+	check(passed[0], "alice to bob, two threads"  );
+	check(passed[1], "alice to carol, two threads");
+	
+	//Each channel counted only its own keys: 2 sent and 1 received on each of Alice's.
+	check(otp_files_left(alice_bob  , true ) == (keys_per_way - 2), "alice-bob encrypt count"  );
+	check(otp_files_left(alice_bob  , false) == (keys_per_way - 1), "alice-bob decrypt count"  );
+	check(otp_files_left(alice_carol, true ) == (keys_per_way - 2), "alice-carol encrypt count");
+	check(otp_files_left(bob_end    , false) == (keys_per_way - 2), "bob decrypt count"        );
+	check(send(alice_bob, bob_end, 30) == true , "alice to bob, last key");
+	check(send(alice_bob, bob_end, 31) == false, "alice to bob, keys depleted");
+	check(send(alice_carol, carol_end, 32) == true, "alice to carol, after bob's keys ran out");
+	
+	char folder_now[4096];
+	check((getcwd(folder_now, sizeof(folder_now)) != 0) && (strcmp(folder_now, start_folder) == 0), "current directory unchanged");
+	
+	otp_store_close(alice_bob);
+	otp_store_close(alice_carol);
+	otp_store_close(bob_end);
+	otp_store_close(carol_end);
+	if(system((string("rm -rf ") + root).c_str()) != 0) {printf("(could not remove %s)\n", root);}
+	
+	if(failures > 0) {return 1;}
+	printf("passed\n");
+	return 0;
+}